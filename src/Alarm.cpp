@@ -42,6 +42,7 @@ public:
 
     QString name;
     QDateTime time;
+    Alarm::Recurrence recurrence{Alarm::NoRecurrence};
 
     //TODO: It would be great to represent commands as objects, not strings
     QStringList commands;
@@ -101,6 +102,47 @@ void Alarm::setTime(const QDateTime& time)
     }
 }
 
+Alarm::Recurrence Alarm::recurrence() const
+{
+    return d->recurrence;
+}
+
+void Alarm::setRecurrence(Recurrence recurrence)
+{
+    if (d->recurrence != recurrence) {
+        d->recurrence = recurrence;
+        Q_EMIT recurrenceChanged();
+        Q_EMIT alarmChanged();
+    }
+}
+
+QDateTime Alarm::nextOccurrence(const QDateTime& after) const
+{
+    if (d->time > after) {
+        return d->time;
+    }
+    int step{0};
+    switch (d->recurrence) {
+        case Daily:
+            step = 1;
+            break;
+        case Weekly:
+            step = 7;
+            break;
+        case NoRecurrence:
+        default:
+            return QDateTime();
+    }
+    // Jump most of the way there in one go, and then step forward until we're past the given time. Adding days
+    // rather than milliseconds means we stay on the same time of day, even if daylight saving happened in between.
+    const qint64 days = d->time.date().daysTo(after.date());
+    QDateTime next = d->time.addDays(qMax<qint64>(0, days - step - (days % step)));
+    while (next <= after) {
+        next = next.addDays(step);
+    }
+    return next;
+}
+
 QStringList Alarm::commands() const
 {
     return d->commands;
@@ -141,6 +183,7 @@ QVariantMap Alarm::toVariantMap() const
 
     result[QLatin1String{"name"}] = name();
     result[QLatin1String{"time"}] = time();
+    result[QLatin1String{"recurrence"}] = recurrence();
     result[QLatin1String{"commands"}] = commands();
 
     return result;
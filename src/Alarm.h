@@ -34,9 +34,17 @@ class Alarm : public QObject
     //TODO: It seems we do not need Q_PROPERTIES here because in qml we use QVariantList and QVariantMap
     Q_PROPERTY(QString name READ name WRITE setName NOTIFY nameChanged)
     Q_PROPERTY(QDateTime time READ time WRITE setTime NOTIFY timeChanged)
+    Q_PROPERTY(Recurrence recurrence READ recurrence WRITE setRecurrence NOTIFY recurrenceChanged)
     Q_PROPERTY(QStringList commands READ commands WRITE setCommands NOTIFY commandsChanged)
 
 public:
+    enum Recurrence {
+        NoRecurrence = 0, ///< The alarm goes off once, at its time
+        Daily, ///< The alarm goes off every day, at the time of day it was set for
+        Weekly, ///< The alarm goes off every week, on the day and at the time it was set for
+    };
+    Q_ENUM(Recurrence)
+
     explicit Alarm(QObject *parent = nullptr);
     explicit Alarm(const QString& name, QObject* parent = nullptr);
 
@@ -51,6 +59,17 @@ public:
     QDateTime time() const;
     void setTime(const QDateTime& time);
 
+    Recurrence recurrence() const;
+    void setRecurrence(Recurrence recurrence);
+    /**
+     * The first time this alarm goes off after the given point in time. For
+     * recurring alarms, this keeps to the same time of day on the local clock,
+     * also across daylight saving changes.
+     * @param after The point in time after which to look
+     * @return The next time the alarm goes off, or an invalid QDateTime if it never will
+     */
+    QDateTime nextOccurrence(const QDateTime& after) const;
+
     QStringList commands() const;
     void setCommands(const QStringList& commands);
 
@@ -64,6 +83,7 @@ public Q_SLOTS:
 Q_SIGNALS:
     void nameChanged();
     void timeChanged();
+    void recurrenceChanged();
     void commandsChanged();
 
     void alarmChanged();
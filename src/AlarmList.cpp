@@ -18,56 +18,129 @@
 #include "AlarmList.h"
 #include "Alarm.h"
 
+#include "Clock.h"
 #include "CommandQueue.h"
+#include "DeadlineScheduler.h"
 
 #include <QDebug>
-#include <QTimer>
+
+#include <algorithm>
+#include <vector>
 
 class AlarmList::Private
 {
 public:
     Private(AlarmList* qq)
         : q(qq)
-        , alarmTimer(new QTimer(qq))
     {
-        // We run to the minute, so wake up every half minute to check if we have an alarm coming up
-        // NB: The timer only runs when there is more than zero alarms in the list.
-        alarmTimer->setInterval(0.5 * 60000);
-        QObject::connect(alarmTimer, &QTimer::timeout, qq, [this](){ checkAlarms(); });
+        handledUntil = scheduler->clock()->currentDateTime();
+    }
+    ~Private() {
+        scheduler->cancel(wakeup);
     }
     AlarmList* q;
     CommandQueue* commandQueue = nullptr;
 
     QList<Alarm*> list;
 
-    QTimer* alarmTimer = nullptr;
-    void checkAlarms() {
-        if(!commandQueue) {
-            qDebug() << "You forgot to set the command queue on the alarm list, silly person!";
+    struct HeapEntry {
+        qint64 fireAt;
+        Alarm* alarm;
+        // std::push_heap and friends build a max-heap, so invert the comparison to get the earliest alarm on top
+        bool operator<(const HeapEntry& other) const {
+            return fireAt > other.fireAt;
+        }
+    };
+    // The next occurrence of every alarm, earliest first
+    std::vector<HeapEntry> heap;
+    // Everything up until this point in (wall clock) time has been dealt with
+    QDateTime handledUntil;
+
+    // The wakeup is timed on the monotonic clock, so if the wall clock is changed underneath us (by the user,
+    // the network, or moving to a different timezone), we'd not notice. Look again every so often to catch that.
+    static constexpr qint64 resyncInterval{30 * 60000};
+    // If we get woken up more than this long after we asked to be (say, because the device was asleep), the alarms
+    // which were due are skipped rather than fired late. This is measured on a clock which keeps counting while the
+    // device is suspended, but isn't touched by changes to the wall clock, so a jump past an alarm still fires it.
+    static constexpr qint64 maximumLateness{5 * 60000};
+    // The scheduler may wake us up ever so slightly early
+    static constexpr qint64 earlyTolerance{50};
+    DeadlineScheduler* scheduler{DeadlineScheduler::instance()};
+    DeadlineScheduler::Handle wakeup{0};
+    // When the wakeup is supposed to happen, on the clock which counts time spent suspended
+    qint64 wakeupDeadline{0};
+
+    void rebuild() {
+        heap.clear();
+        heap.reserve(list.count());
+        for (Alarm* alarm : std::as_const(list)) {
+            const QDateTime next = alarm->nextOccurrence(handledUntil);
+            if (next.isValid()) {
+                heap.push_back(HeapEntry{next.toMSecsSinceEpoch(), alarm});
+            }
+        }
+        std::make_heap(heap.begin(), heap.end());
+    }
+
+    void arm() {
+        if (heap.empty()) {
+            scheduler->cancel(wakeup);
+            wakeup = 0;
             return;
         }
-        quint64 now = QDateTime::currentDateTime().toMSecsSinceEpoch();
-        quint64 interval(alarmTimer->interval());
-        for( Alarm* alarm : list)
-        {
-            quint64 then = alarm->time().toMSecsSinceEpoch();
-            if(now < then)
-            {
-//                 qDebug() << "Event is in the future, let's see if it's near enough...";
-                quint64 until = then - now;
-                if(until < interval)
-                {
-//                     qDebug() << "Event is within our check interval, so launch it now";
-                    commandQueue->clear({});
-                    commandQueue->pushPause(until, {});
+        const qint64 now = scheduler->clock()->currentDateTime().toMSecsSinceEpoch();
+        const qint64 delay = qBound<qint64>(0, heap.front().fireAt - now, resyncInterval);
+        wakeupDeadline = scheduler->clock()->elapsedSinceBoot() + delay;
+        scheduler->reschedule(wakeup, int(delay), q, [this](){
+            wakeup = 0;
+            wake();
+        });
+    }
+
+    // Call this whenever the alarms change, to start over from the current time
+    void resync() {
+        handledUntil = scheduler->clock()->currentDateTime();
+        rebuild();
+        arm();
+    }
+
+    void wake() {
+        const QDateTime nowDateTime = scheduler->clock()->currentDateTime();
+        const qint64 now = nowDateTime.toMSecsSinceEpoch();
+        if (nowDateTime < handledUntil) {
+            // The clock went backwards, so anything we had lined up is now further away than we thought
+            resync();
+            return;
+        }
+        const qint64 wakeupLateness = scheduler->clock()->elapsedSinceBoot() - wakeupDeadline;
+        QList<Alarm*> due;
+        while (!heap.empty() && heap.front().fireAt <= now + earlyTolerance) {
+            const HeapEntry entry = heap.front();
+            std::pop_heap(heap.begin(), heap.end());
+            heap.pop_back();
+            if (wakeupLateness > maximumLateness) {
+                qDebug() << "Skipping the alarm" << entry.alarm->name() << "as we woke up" << wakeupLateness / 1000 << "seconds late for it";
+            } else if (!entry.alarm->commands().isEmpty()) {
+                due << entry.alarm;
+            }
+        }
+        // Make sure anything we've just dealt with is not picked up again, even if we were woken a touch early
+        handledUntil = qMax(nowDateTime, QDateTime::fromMSecsSinceEpoch(now + earlyTolerance));
+        if (!due.isEmpty()) {
+            if (commandQueue) {
+                // Several alarms may go off at the same time, so clear the queue once, and then line them all up
+                commandQueue->clear({});
+                for (Alarm* alarm : std::as_const(due)) {
+                    qDebug() << "Alarm" << alarm->name() << "is going off";
                     commandQueue->pushCommands(alarm->commands(), {});
-                    break;
                 }
-                // TODO This doesn't handle two alarms set to go off within the same interval (in other words
-                // set on the same minute point). If this turns out to be something people do, we can fix that,
-                // but until then, let's not worry about that...
+            } else {
+                qDebug() << "You forgot to set the command queue on the alarm list, silly person!";
             }
         }
+        // Recurring alarms will now have a new next occurrence, and this also catches any wall clock changes
+        rebuild();
+        arm();
     }
 };
 
@@ -152,9 +225,10 @@ int AlarmList::alarmIndex(const QString& name) const
     return -1;;
 }
 
-void AlarmList::addAlarm(const QString& name, const QDateTime& time, const QStringList& commands)
+void AlarmList::addAlarm(const QString& name, const QDateTime& time, const QStringList& commands, Alarm::Recurrence recurrence)
 {
     Alarm* alarm = new Alarm(name, time, commands, this);
+    alarm->setRecurrence(recurrence);
     addAlarm(alarm);
 }
 
@@ -175,13 +249,14 @@ void AlarmList::addAlarm(Alarm* alarm)
     alarm->setParent(this);
 
     connect(alarm, &Alarm::alarmChanged, this, &AlarmList::listChanged);
+    connect(alarm, &Alarm::timeChanged, this, [this](){ d->resync(); });
+    connect(alarm, &Alarm::recurrenceChanged, this, [this](){ d->resync(); });
 
     d->list.insert(0, alarm);
     Q_EMIT listChanged();
     endInsertRows();
 
-    // Once we've added an alarm, start the timer
-    d->alarmTimer->start();
+    d->resync();
 }
 
 void AlarmList::addAlarm(const QString& alarmName)
@@ -224,10 +299,7 @@ void AlarmList::removeAlarmByIndex(int index)
     Q_EMIT listChanged();
     endRemoveRows();
 
-    // When there are no more alarms, stop the timer
-    if(d->list.count() == 0) {
-        d->alarmTimer->stop();
-    }
+    d->resync();
 }
 
 void AlarmList::changeAlarmName(const QString& oldName, const QString& newName)
@@ -261,6 +333,17 @@ void AlarmList::setAlarmTime(const QString& alarmName, const QDateTime& time)
     }
 }
 
+void AlarmList::setAlarmRecurrence(const QString& alarmName, Alarm::Recurrence recurrence)
+{
+    Alarm* alarm = this->alarm(alarmName);
+
+    if (alarm) {
+        alarm->setRecurrence(recurrence);
+    } else {
+        Q_EMIT alarmNotExisted(alarmName);
+    }
+}
+
 void AlarmList::setAlarmCommands(const QString& alarmName, const QStringList& commands)
 {
     Alarm* alarm = this->alarm(alarmName);
@@ -325,3 +408,14 @@ void AlarmList::setCommandQueue(CommandQueue* commandQueue)
 {
     d->commandQueue = commandQueue;
 }
+
+void AlarmList::setScheduler(DeadlineScheduler* scheduler)
+{
+    if (!scheduler || scheduler == d->scheduler) {
+        return;
+    }
+    d->scheduler->cancel(d->wakeup);
+    d->wakeup = 0;
+    d->scheduler = scheduler;
+    d->resync();
+}
@@ -20,8 +20,10 @@
 
 #include <QAbstractListModel>
 
-class Alarm;
+#include "Alarm.h"
+
 class CommandQueue;
+class DeadlineScheduler;
 
 /**
  * @brief The AlarmList class represents collection of all alarm moves.
@@ -33,6 +35,12 @@ class CommandQueue;
  *
  * Now we use the AlarmList class via AppSettings,
  * but later we may want to use it as a separated model via QAbstractItemModelReplica.
+ *
+ * The list also takes care of making the alarms go off. The next occurrence of
+ * each alarm is kept in a heap, and a single wakeup is scheduled for the
+ * earliest of them (or in half an hour, whichever is sooner, to catch the
+ * device's clock or timezone being changed). Any alarms which are due at the
+ * same time are all fired together.
  */
 class AlarmList : public QAbstractListModel
 {
@@ -60,7 +68,7 @@ public:
     Alarm* alarm(const QString& name) const;
     int alarmIndex(const QString& name) const;
 
-    void addAlarm(const QString& name, const QDateTime& time, const QStringList& commands);
+    void addAlarm(const QString& name, const QDateTime& time, const QStringList& commands, Alarm::Recurrence recurrence = Alarm::NoRecurrence);
 
     /**
      * Add a new alarm to the model.
@@ -78,6 +86,7 @@ public:
 
     void changeAlarmName(const QString& oldName, const QString& newName);
     void setAlarmTime(const QString& alarmName, const QDateTime& time);
+    void setAlarmRecurrence(const QString& alarmName, Alarm::Recurrence recurrence);
     void setAlarmCommands(const QString& alarmName, const QStringList& commands);
     void addAlarmCommand(const QString& alarmName, int index, const QString& command, QStringList devices);
     void removeAlarmCommand(const QString& alarmName, int index);
@@ -86,6 +95,12 @@ public:
     QVariantMap getAlarmVariantMap(const QString& alarmName);
 
     void setCommandQueue(CommandQueue* commandQueue);
+    /**
+     * Set the scheduler used to wake up for upcoming alarms, and whose clock is
+     * used to tell the time. By default this is DeadlineScheduler::instance().
+     * @param scheduler The scheduler to use (not taken ownership of)
+     */
+    void setScheduler(DeadlineScheduler* scheduler);
 public Q_SLOTS:
 
 Q_SIGNALS:
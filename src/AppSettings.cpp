@@ -46,6 +46,13 @@ public:
     int idleMinPause = 15;
     int idleMaxPause = 60;
     bool fakeTailMode = false;
+    int reconnectBaseDelay = 250;
+    int reconnectMaxDelay = 8000;
+    int reconnectMaxAttempts = 10;
+    int reconnectSlowInterval = 60;
+    int maxConcurrentConnections = 3;
+    bool synchronizedStart = false;
+    bool learnCommandDurations = false;
     QString languageOverride;
 
     QMap<QString, QStringList> moveLists;
@@ -74,6 +81,13 @@ AppSettings::AppSettings(QObject* parent)
     d->idleMinPause = settings.value("idleMinPause", d->idleMinPause).toInt();
     d->idleMaxPause = settings.value("idleMaxPause", d->idleMaxPause).toInt();
     d->fakeTailMode = settings.value("fakeTailMode", d->fakeTailMode).toBool();
+    d->reconnectBaseDelay = settings.value("reconnectBaseDelay", d->reconnectBaseDelay).toInt();
+    d->reconnectMaxDelay = settings.value("reconnectMaxDelay", d->reconnectMaxDelay).toInt();
+    d->reconnectMaxAttempts = settings.value("reconnectMaxAttempts", d->reconnectMaxAttempts).toInt();
+    d->reconnectSlowInterval = settings.value("reconnectSlowInterval", d->reconnectSlowInterval).toInt();
+    d->maxConcurrentConnections = settings.value("maxConcurrentConnections", d->maxConcurrentConnections).toInt();
+    d->synchronizedStart = settings.value("synchronizedStart", d->synchronizedStart).toBool();
+    d->learnCommandDurations = settings.value("learnCommandDurations", d->learnCommandDurations).toBool();
     d->languageOverride = settings.value("languageOverride", d->languageOverride).toString();
 
     settings.beginGroup("MoveLists");
@@ -326,6 +340,118 @@ void AppSettings::setFakeTailMode(bool fakeTailMode)
     }
 }
 
+int AppSettings::reconnectBaseDelay() const
+{
+    return d->reconnectBaseDelay;
+}
+
+void AppSettings::setReconnectBaseDelay(int delay)
+{
+    qDebug() << Q_FUNC_INFO << delay;
+    if(delay != d->reconnectBaseDelay) {
+        d->reconnectBaseDelay = delay;
+        QSettings settings;
+        settings.setValue("reconnectBaseDelay", d->reconnectBaseDelay);
+        Q_EMIT reconnectBaseDelayChanged(delay);
+    }
+}
+
+int AppSettings::reconnectMaxDelay() const
+{
+    return d->reconnectMaxDelay;
+}
+
+void AppSettings::setReconnectMaxDelay(int delay)
+{
+    qDebug() << Q_FUNC_INFO << delay;
+    if(delay != d->reconnectMaxDelay) {
+        d->reconnectMaxDelay = delay;
+        QSettings settings;
+        settings.setValue("reconnectMaxDelay", d->reconnectMaxDelay);
+        Q_EMIT reconnectMaxDelayChanged(delay);
+    }
+}
+
+int AppSettings::reconnectMaxAttempts() const
+{
+    return d->reconnectMaxAttempts;
+}
+
+void AppSettings::setReconnectMaxAttempts(int attempts)
+{
+    qDebug() << Q_FUNC_INFO << attempts;
+    if(attempts != d->reconnectMaxAttempts) {
+        d->reconnectMaxAttempts = attempts;
+        QSettings settings;
+        settings.setValue("reconnectMaxAttempts", d->reconnectMaxAttempts);
+        Q_EMIT reconnectMaxAttemptsChanged(attempts);
+    }
+}
+
+int AppSettings::reconnectSlowInterval() const
+{
+    return d->reconnectSlowInterval;
+}
+
+void AppSettings::setReconnectSlowInterval(int interval)
+{
+    qDebug() << Q_FUNC_INFO << interval;
+    if(interval != d->reconnectSlowInterval) {
+        d->reconnectSlowInterval = interval;
+        QSettings settings;
+        settings.setValue("reconnectSlowInterval", d->reconnectSlowInterval);
+        Q_EMIT reconnectSlowIntervalChanged(interval);
+    }
+}
+
+int AppSettings::maxConcurrentConnections() const
+{
+    return d->maxConcurrentConnections;
+}
+
+void AppSettings::setMaxConcurrentConnections(int connections)
+{
+    qDebug() << Q_FUNC_INFO << connections;
+    if(connections != d->maxConcurrentConnections) {
+        d->maxConcurrentConnections = connections;
+        QSettings settings;
+        settings.setValue("maxConcurrentConnections", d->maxConcurrentConnections);
+        Q_EMIT maxConcurrentConnectionsChanged(connections);
+    }
+}
+
+bool AppSettings::synchronizedStart() const
+{
+    return d->synchronizedStart;
+}
+
+void AppSettings::setSynchronizedStart(bool synchronizedStart)
+{
+    qDebug() << Q_FUNC_INFO << synchronizedStart;
+    if (synchronizedStart != d->synchronizedStart) {
+        d->synchronizedStart = synchronizedStart;
+        QSettings settings;
+        settings.setValue("synchronizedStart", d->synchronizedStart);
+        Q_EMIT synchronizedStartChanged(synchronizedStart);
+    }
+}
+
+bool AppSettings::learnCommandDurations() const
+{
+    return d->learnCommandDurations;
+}
+
+void AppSettings::setLearnCommandDurations(bool learnCommandDurations)
+{
+    qDebug() << Q_FUNC_INFO << learnCommandDurations;
+    if (learnCommandDurations != d->learnCommandDurations) {
+        d->learnCommandDurations = learnCommandDurations;
+        QSettings settings;
+        settings.setValue("learnCommandDurations", d->learnCommandDurations);
+        Q_EMIT learnCommandDurationsChanged(learnCommandDurations);
+    }
+}
+
 QStringList AppSettings::moveLists() const
 {
     QStringList keys = d->moveLists.keys();
@@ -468,6 +594,16 @@ void AppSettings::setAlarmTime(const QDateTime &time)
     Q_EMIT activeAlarmChanged(activeAlarm());
 }
 
+void AppSettings::setAlarmRecurrence(int recurrence)
+{
+    if (recurrence < Alarm::NoRecurrence || recurrence > Alarm::Weekly) {
+        qWarning() << "Attempted to set an unknown recurrence" << recurrence << "on the alarm" << d->activeAlarmName;
+        return;
+    }
+    d->alarmList->setAlarmRecurrence(d->activeAlarmName, static_cast<Alarm::Recurrence>(recurrence));
+    Q_EMIT activeAlarmChanged(activeAlarm());
+}
+
 void AppSettings::setAlarmCommands(const QStringList& commands)
 {
     d->alarmList->setAlarmCommands(d->activeAlarmName, commands);
@@ -499,8 +635,9 @@ void AppSettings::loadAlarmList()
         const QString name = settings.value("name").toString();
         const QDateTime time = settings.value("time").toDateTime();
         const QStringList commands = settings.value("commands").toStringList();
+        const Alarm::Recurrence recurrence = static_cast<Alarm::Recurrence>(settings.value("recurrence", Alarm::NoRecurrence).toInt());
 
-        d->alarmList->addAlarm(name, time, commands);
+        d->alarmList->addAlarm(name, time, commands, recurrence);
     }
 
     settings.endArray();
@@ -520,6 +657,7 @@ void AppSettings::saveAlarmList()
 
         settings.setValue("name", alarm->name());
         settings.setValue("time", alarm->time());
+        settings.setValue("recurrence", int(alarm->recurrence()));
         settings.setValue("commands", alarm->commands());
     }
 
@@ -63,6 +63,55 @@ public:
     bool fakeTailMode() const override;
     void setFakeTailMode(bool fakeTailMode) override;
 
+    /**
+     * The delay (in milliseconds) before the first automatic reconnection attempt.
+     * Each following attempt doubles this, up to reconnectMaxDelay.
+     */
+    int reconnectBaseDelay() const override;
+    void setReconnectBaseDelay(int delay) override;
+
+    /**
+     * The longest delay (in milliseconds) between two quick automatic reconnection attempts
+     */
+    int reconnectMaxDelay() const override;
+    void setReconnectMaxDelay(int delay) override;
+
+    /**
+     * How many quick automatic reconnection attempts to make before dropping to slow retries
+     */
+    int reconnectMaxAttempts() const override;
+    void setReconnectMaxAttempts(int attempts) override;
+
+    /**
+     * The number of seconds between slow retries, once the quick attempts have been exhausted
+     */
+    int reconnectSlowInterval() const override;
+    void setReconnectSlowInterval(int interval) override;
+
+    /**
+     * The largest number of connection attempts to run at the same time when
+     * connecting to several pieces of gear at once. Android's bluetooth stack
+     * gets unhappy with too many pending connections, so keep this low.
+     */
+    int maxConcurrentConnections() const override;
+    void setMaxConcurrentConnections(int connections) override;
+
+    /**
+     * Whether to stagger the writes when sending the same command to several
+     * pieces of gear, based on how long each takes to receive a message, so
+     * that they all start moving at the same time.
+     */
+    bool synchronizedStart() const override;
+    void setSynchronizedStart(bool synchronizedStart) override;
+
+    /**
+     * Whether to use the command durations learned from watching the gear
+     * run them, in place of the ones in the commands files, when working out
+     * how long to wait before sending the next command in a queue.
+     */
+    bool learnCommandDurations() const override;
+    void setLearnCommandDurations(bool learnCommandDurations) override;
+
     QStringList moveLists() const override;
     QStringList moveList() const override;
     void setActiveMoveList(const QString& moveListName) override;
@@ -79,6 +128,7 @@ public:
     void setActiveAlarmName(const QString& alarmName) override;
     void changeAlarmName(const QString& newName) override;
     void setAlarmTime(const QDateTime& time) override;
+    void setAlarmRecurrence(int recurrence) override;
     void setAlarmCommands(const QStringList& commands) override;
     void addAlarmCommand(int index, const QString& command, QStringList devices) override;
     void removeAlarmCommand(int index) override;
@@ -21,6 +21,10 @@
 #include "gearimplementations/GearEars.h"
 #include "CommandQueue.h"
 #include "AppSettings.h"
+#include "CommandTracer.h"
+#include "FlightRecorder.h"
+#include "LinkTelemetry.h"
+#include "ReconnectionPolicy.h"
 
 #include <QBluetoothDeviceDiscoveryAgent>
 #include <QBluetoothServiceDiscoveryAgent>
@@ -83,6 +87,7 @@ BTConnectionManager::BTConnectionManager(AppSettings* appSettings, QObject* pare
             this, [this](){ Q_EMIT deviceCountChanged(d->deviceModel->count()); });
     connect(d->deviceModel, &DeviceModel::deviceConnected, this, [this](GearBase* device){ Q_EMIT deviceConnected(device->deviceID()); });
     connect(d->deviceModel, &DeviceModel::isConnectedChanged, this, &BTConnectionManager::isConnectedChanged);
+    connect(d->deviceModel, &DeviceModel::connectionProgress, this, &BTConnectionManager::connectionProgress);
 
     qDebug() << Q_FUNC_INFO << "Setting Command Model";
     d->commandModel = new CommandModel(this);
@@ -92,6 +97,10 @@ BTConnectionManager::BTConnectionManager(AppSettings* appSettings, QObject* pare
     qDebug() << Q_FUNC_INFO << "Creating device discovery agent";
     d->deviceDiscoveryAgent = new QBluetoothDeviceDiscoveryAgent(this);
     connect(d->deviceDiscoveryAgent, SIGNAL(deviceDiscovered(QBluetoothDeviceInfo)), d->deviceModel, SLOT(addDevice(QBluetoothDeviceInfo)));
+    // Updates carry fresh signal strength for gear we already know about, which the device model takes care of
+    connect(d->deviceDiscoveryAgent, &QBluetoothDeviceDiscoveryAgent::deviceUpdated, d->deviceModel, [this](const QBluetoothDeviceInfo& info, QBluetoothDeviceInfo::Fields /*updatedFields*/){
+        d->deviceModel->addDevice(info);
+    });
 
     connect(d->deviceDiscoveryAgent, &QBluetoothDeviceDiscoveryAgent::finished, [this](){
         qDebug() << "Device discovery completed";
@@ -120,10 +129,18 @@ AppSettings* BTConnectionManager::appSettings() const
 
 void BTConnectionManager::setAppSettings(AppSettings* appSettings)
 {
+    if (d->appSettings) {
+        d->appSettings->disconnect(this);
+    }
     d->appSettings = appSettings;
     if (d->deviceModel) {
         d->deviceModel->setAppSettings(d->appSettings);
     }
+    // Command tracing is a developer tool, so only keep it running while developer mode is on
+    CommandTracer::instance()->setEnabled(appSettings && appSettings->developerMode());
+    if (appSettings) {
+        connect(appSettings, &AppSettings::developerModeChanged, this, [](bool developerMode){ CommandTracer::instance()->setEnabled(developerMode); });
+    }
 }
 
 void BTConnectionManager::setLocalBTDeviceState()
@@ -179,10 +196,18 @@ void BTConnectionManager::connectToDevice(const QString& deviceID)
         if (device->isKnown() == false) {
             device->setAutoConnect(d->appSettings->autoReconnect());
         }
+        // An explicit connection request starts over, rather than waiting for a pending automatic attempt
+        device->reconnectionPolicy()->cancel();
         device->connectDevice();
     }
 }
 
+void BTConnectionManager::connectToAllKnownDevices()
+{
+    qDebug() << Q_FUNC_INFO;
+    d->deviceModel->connectToAllKnownDevices();
+}
+
 void BTConnectionManager::disconnectDevice(const QString& deviceID)
 {
     if(deviceID.isEmpty()) {
@@ -195,6 +220,10 @@ void BTConnectionManager::disconnectDevice(const QString& deviceID)
         }
     } else {
         GearBase* device = d->deviceModel->getDevice(deviceID);
+        if (device) {
+            // The user explicitly asked for the gear to be disconnected, so stop attempting to reconnect it
+            device->reconnectionPolicy()->cancel();
+        }
         if (device && device->isConnected()) {
             device->disconnectDevice();
             d->commandQueue->clear(device->deviceID());
@@ -210,7 +239,13 @@ QObject* BTConnectionManager::deviceModel() const
 
 void BTConnectionManager::sendMessage(const QString &message, const QStringList& deviceIDs)
 {
-    d->deviceModel->sendMessage(message, deviceIDs);
+    sendMessage(message, d->deviceModel->deviceSet(deviceIDs));
+}
+
+void BTConnectionManager::sendMessage(const QString &message, DeviceModel::DeviceSet deviceSet)
+{
+    CommandTracer::instance()->instant("BTConnectionManager::sendMessage", message);
+    d->deviceModel->sendMessage(message, deviceSet);
 }
 
 void BTConnectionManager::runCommand(const QString& command)
@@ -294,6 +329,34 @@ QVariantMap BTConnectionManager::getCommand(const QString& command)
     return info;
 }
 
+QVariantMap BTConnectionManager::deviceTelemetry(const QString& deviceID)
+{
+    GearBase* device = d->deviceModel->getDevice(deviceID);
+    if (device) {
+        return device->linkTelemetry()->toVariantMap();
+    }
+    return QVariantMap{};
+}
+
+QString BTConnectionManager::commandTrace()
+{
+    if (d->appSettings && d->appSettings->developerMode()) {
+        return QString::fromUtf8(CommandTracer::instance()->toChromeTraceJson());
+    }
+    return QString{};
+}
+
+QString BTConnectionManager::deviceFlightRecording(const QString& deviceID)
+{
+    if (d->appSettings && d->appSettings->developerMode()) {
+        GearBase* device = d->deviceModel->getDevice(deviceID);
+        if (device) {
+            return device->flightRecorder()->dump();
+        }
+    }
+    return QString{};
+}
+
 void BTConnectionManager::setDeviceName(const QString& deviceID, const QString& deviceName)
 {
     GearBase* device = d->deviceModel->getDevice(deviceID);
@@ -24,6 +24,7 @@
 #include <QBluetoothLocalDevice>
 #include <QLowEnergyService>
 
+#include "DeviceModel.h"
 #include "rep_BTConnectionManagerProxy_source.h"
 
 class AppSettings;
@@ -61,9 +62,23 @@ public:
     QVariantMap command() const override;
     int bluetoothState() const override;
 
+    /**
+     * Send a message to all the devices in the given set. This is the same as
+     * the slot taking a list of device IDs, for callers which already have a
+     * DeviceModel::DeviceSet to hand.
+     * @param message The message to be sent out
+     * @param deviceSet The set of devices to send the message to
+     */
+    void sendMessage(const QString &message, DeviceModel::DeviceSet deviceSet);
+
 public Q_SLOTS:
     void sendMessage(const QString &message, const QStringList& deviceIDs) override;
     void connectToDevice(const QString& deviceID) override;
+    /**
+     * Connect to all known gear which is set to connect automatically. Progress
+     * is reported through the connectionProgress signal.
+     */
+    void connectToAllKnownDevices() override;
     /**
      * Disconnect from the specified device, or if no deviceID is given, disconnect from everything
      * @param deviceID The ID of the device you wish to disconnect from
@@ -73,6 +88,26 @@ public Q_SLOTS:
     QVariantMap getCommand(const QString& command) override;
     void setLocalBTDeviceState();
     void setDeviceName(const QString& deviceId, const QString& deviceName) override;
+    /**
+     * Timings and counts describing how well the link to the specified device
+     * is doing (see LinkTelemetry::toVariantMap for the contents)
+     * @param deviceID The ID of the device you want the telemetry for
+     * @return The telemetry, or an empty map if there is no such device
+     */
+    QVariantMap deviceTelemetry(const QString& deviceID) override;
+    /**
+     * The recently traced command stages, in the Chrome trace event format
+     * (see CommandTracer::toChromeTraceJson). Tracing only happens in developer
+     * mode, and outside of it this returns an empty string.
+     */
+    QString commandTrace() override;
+    /**
+     * The most recent traffic between us and the specified device, one event
+     * per line (see FlightRecorder::dump). Only available in developer mode,
+     * and outside of it this returns an empty string.
+     * @param deviceID The ID of the device you want the recording for
+     */
+    QString deviceFlightRecording(const QString& deviceID) override;
 
     /**
      * Whether or not a device is marked in the device model
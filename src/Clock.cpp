@@ -0,0 +1,54 @@
+/*
+ *   Copyright 2026 Dan Leinir Turthra Jensen <admin@leinir.dk>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 3, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Library General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public License
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>
+ */
+
+#include "Clock.h"
+
+#include <QElapsedTimer>
+
+#ifdef Q_OS_LINUX
+#include <time.h>
+#endif
+
+class SystemClock : public Clock
+{
+public:
+    SystemClock() { timer.start(); }
+    ~SystemClock() override {}
+
+    qint64 elapsed() const override { return timer.elapsed(); }
+    qint64 elapsedSinceBoot() const override {
+#ifdef Q_OS_LINUX
+        // The monotonic clock QElapsedTimer uses stops while suspended, but the boot time clock keeps going
+        timespec time;
+        if (clock_gettime(CLOCK_BOOTTIME, &time) == 0) {
+            return qint64(time.tv_sec) * 1000 + time.tv_nsec / 1000000;
+        }
+#endif
+        return timer.elapsed();
+    }
+    QDateTime currentDateTime() const override { return QDateTime::currentDateTime(); }
+private:
+    QElapsedTimer timer;
+};
+
+Clock::~Clock() = default;
+
+Clock* Clock::system()
+{
+    static SystemClock clock;
+    return &clock;
+}
@@ -0,0 +1,60 @@
+/*
+ *   Copyright 2026 Dan Leinir Turthra Jensen <admin@leinir.dk>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 3, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Library General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public License
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>
+ */
+
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <QDateTime>
+
+/**
+ * Where the service gets its idea of what time it is from.
+ *
+ * Anything which needs to know the time (or, through DeadlineScheduler, wait
+ * for some amount of it to pass) should ask a clock, rather than asking
+ * QDateTime or a QElapsedTimer directly, so there is one place to change
+ * where the time comes from.
+ */
+class Clock
+{
+public:
+    virtual ~Clock();
+
+    /**
+     * The clock used throughout the service, unless something else is set
+     */
+    static Clock* system();
+
+    /**
+     * Monotonically increasing milliseconds, from some arbitrary starting point.
+     * Use this for measuring durations, and for anything else which should not
+     * be affected by the user changing the time on their device.
+     */
+    virtual qint64 elapsed() const = 0;
+    /**
+     * Like elapsed(), but also counting any time the device spent suspended,
+     * which elapsed() does not on all systems. Use this to find out whether
+     * something happened a lot later than it was supposed to.
+     */
+    virtual qint64 elapsedSinceBoot() const = 0;
+    /**
+     * The current local date and time, for things which actually care what the
+     * time on the wall says (such as alarms)
+     */
+    virtual QDateTime currentDateTime() const = 0;
+};
+
+#endif//CLOCK_H
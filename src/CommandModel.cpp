@@ -190,6 +190,9 @@ public:
                         }
                         theEntry->command.isAvailable = anyAvailable;
                         ourRoles << CommandModel::IsAvailable;
+                    } else if (role == GearCommandModel::Duration) {
+                        // The device has learned how long the command really takes, so make sure the queue knows as well
+                        updateEntryDurations(theEntry);
                     }
                 }
                 q->dataChanged(q->index(entryIdx), q->index(entryIdx), ourRoles);
@@ -18,27 +18,24 @@
 #include "CommandQueue.h"
 #include "BTConnectionManager.h"
 #include "CommandModel.h"
+#include "CommandTracer.h"
+#include "DeadlineScheduler.h"
 #include "DeviceModel.h"
 
-#include <QTimer>
-
 class CommandQueue::Private
 {
 public:
     Private(CommandQueue* qq, BTConnectionManager* connectionManager)
         : q(qq)
         , connectionManager(connectionManager)
+        , deviceModel(qobject_cast<DeviceModel*>(connectionManager->deviceModel()))
     {
-        currentCommandTimer = new QTimer(qq);
-        currentCommandTimer->setSingleShot(true);
-        currentCommandTimerChecker = new QTimer(qq);
-        currentCommandTimerChecker->setInterval(100);
-        q->connect(currentCommandTimer, &QTimer::timeout, [this](){
-            currentCommandTimerChecker->stop();
-            Q_EMIT q->currentCommandRemainingMSecondsChanged(0);
-        });
     }
-    ~Private() {}
+    ~Private() {
+        scheduler->cancel(popDeadline);
+        scheduler->cancel(currentCommandDeadline);
+        scheduler->cancel(currentCommandTick);
+    }
 
     CommandQueue* q{nullptr};
 
@@ -48,14 +45,69 @@ public:
         {}
         ~Entry() { }
         CommandInfo command;
-        QStringList deviceIDs;
+        DeviceModel::DeviceSet devices{DeviceModel::AllDevices};
     };
     QVector<Entry*> commands;
     BTConnectionManager* connectionManager{nullptr};
+    DeviceModel* deviceModel{nullptr};
+
+    // Take the given devices out of the queue, and remove any entry which then has nobody left to go to
+    void removeDevices(DeviceModel::DeviceSet devices)
+    {
+        for (int i = commands.count() - 1; i > -1; --i) {
+            Entry* entry = commands[i];
+            if (entry->devices != DeviceModel::AllDevices && (entry->devices & devices)) {
+                entry->devices &= ~devices;
+                if (entry->devices == 0) {
+                    q->beginRemoveRows(QModelIndex(), i, i);
+                    delete commands.takeAt(i);
+                    q->endRemoveRows();
+                }
+            }
+        }
+    }
+
+    DeadlineScheduler* scheduler{DeadlineScheduler::instance()};
+    DeadlineScheduler::Handle popDeadline{0};
+    DeadlineScheduler::Handle currentCommandDeadline{0};
+    DeadlineScheduler::Handle currentCommandTick{0};
+    int currentCommandDuration{0};
 
-    QTimer* popTimer{nullptr};
-    QTimer* currentCommandTimer{nullptr};
-    QTimer* currentCommandTimerChecker{nullptr};
+    bool isWaiting() const {
+        return scheduler->isScheduled(popDeadline);
+    }
+    void schedulePop(int milliseconds) {
+        scheduler->reschedule(popDeadline, milliseconds, q, [this](){
+            popDeadline = 0;
+            pop();
+        });
+    }
+    int currentCommandRemaining() const {
+        return scheduler->remainingTime(currentCommandDeadline);
+    }
+    // Let the UI know how far along the current command is, every tenth of a second until it is done
+    void scheduleTick() {
+        currentCommandTick = scheduler->schedule(100, q, [this](){
+            currentCommandTick = 0;
+            // The command may have finished in the same wakeup as this tick
+            if (!scheduler->isScheduled(currentCommandDeadline)) {
+                return;
+            }
+            scheduleTick();
+            Q_EMIT q->currentCommandRemainingMSecondsChanged(currentCommandRemaining());
+        });
+    }
+    void startCurrentCommand(int duration) {
+        currentCommandDuration = duration;
+        scheduler->reschedule(currentCommandDeadline, duration, q, [this](){
+            currentCommandDeadline = 0;
+            scheduler->cancel(currentCommandTick);
+            currentCommandTick = 0;
+            Q_EMIT q->currentCommandRemainingMSecondsChanged(0);
+        });
+        scheduler->cancel(currentCommandTick);
+        scheduleTick();
+    }
 
     void pop()
     {
@@ -66,15 +118,14 @@ public:
             // Command can be empty if it's a pause (possibly others as well,
             // though not yet, but just never send an empty command)
             if(!entry->command.command.isEmpty()) {
-                connectionManager->sendMessage(entry->command.command, entry->deviceIDs);
-                currentCommandTimer->setInterval(entry->command.duration + entry->command.minimumCooldown);
-                currentCommandTimer->start();
-                currentCommandTimerChecker->start();
-                Q_EMIT q->currentCommandTotalDurationChanged(currentCommandTimer->interval());
-                Q_EMIT q->currentCommandRemainingMSecondsChanged(currentCommandTimer->remainingTime());
+                CommandTracer::instance()->instant("CommandQueue::pop", entry->command.command);
+                connectionManager->sendMessage(entry->command.command, entry->devices);
+                startCurrentCommand(entry->command.duration + entry->command.minimumCooldown);
+                Q_EMIT q->currentCommandTotalDurationChanged(currentCommandDuration);
+                Q_EMIT q->currentCommandRemainingMSecondsChanged(currentCommandRemaining());
             }
 
-            popTimer->start(entry->command.duration + entry->command.minimumCooldown);
+            schedulePop(entry->command.duration + entry->command.minimumCooldown);
 
             Q_EMIT q->countChanged(q->count());
             delete entry;
@@ -86,13 +137,16 @@ CommandQueue::CommandQueue(BTConnectionManager* connectionManager)
     : CommandQueueProxySource(connectionManager)
     , d(new Private(this, connectionManager))
 {
-    d->popTimer = new QTimer(this);
-    d->popTimer->setSingleShot(true);
-    connect(d->popTimer, &QTimer::timeout, this, [this](){ d->pop(); });
-
-    connect(d->currentCommandTimerChecker, &QTimer::timeout, [this](){
-        Q_EMIT currentCommandRemainingMSecondsChanged(d->currentCommandTimer->remainingTime());
-    });
+    // The device's bit in any device set will be handed to the next device to need one, so make sure we don't send anything meant for this one to that one
+    auto forgetDevice = [this](GearBase* device){
+        const DeviceModel::DeviceSet devices = d->deviceModel->deviceSet(device);
+        if (devices != 0) {
+            d->removeDevices(devices);
+            Q_EMIT countChanged(count());
+        }
+    };
+    connect(d->deviceModel, &DeviceModel::deviceRemoved, this, forgetDevice);
+    connect(d->deviceModel, &DeviceModel::deviceDisconnected, this, forgetDevice);
 }
 
 CommandQueue::~CommandQueue()
@@ -157,31 +211,69 @@ int CommandQueue::count() const
     return d->commands.count();
 }
 
+void CommandQueue::setScheduler(DeadlineScheduler* scheduler)
+{
+    if (!scheduler || scheduler == d->scheduler) {
+        return;
+    }
+    // Carry anything already in flight over to the new scheduler
+    const int popRemaining = d->scheduler->remainingTime(d->popDeadline);
+    const int commandRemaining = d->currentCommandRemaining();
+    d->scheduler->cancel(d->popDeadline);
+    d->scheduler->cancel(d->currentCommandDeadline);
+    d->scheduler->cancel(d->currentCommandTick);
+    d->popDeadline = d->currentCommandDeadline = d->currentCommandTick = 0;
+    d->scheduler = scheduler;
+    if (popRemaining > -1) {
+        d->schedulePop(popRemaining);
+    }
+    if (commandRemaining > -1) {
+        const int duration = d->currentCommandDuration;
+        d->startCurrentCommand(commandRemaining);
+        d->currentCommandDuration = duration;
+    }
+}
+
 int CommandQueue::currentCommandRemainingMSeconds() const
 {
-    return d->currentCommandTimer->remainingTime();
+    return d->currentCommandRemaining();
 }
 
 int CommandQueue::currentCommandTotalDuration() const
 {
-    return d->currentCommandTimer->interval();
+    return d->currentCommandDuration;
 }
 
 void CommandQueue::clear(const QString& deviceID)
 {
     // Before doing anything else, ensure the timer doesn't suddenly pick stuff
     // out from underneath us. Stop all functions and let's do the thing.
-    d->popTimer->stop();
+    const int remainingTime = d->scheduler->remainingTime(d->popDeadline);
+    d->scheduler->cancel(d->popDeadline);
+    d->popDeadline = 0;
     if (deviceID.isEmpty()) {
         d->commands.clear();
     } else {
         // Remove the command, but only if the command is requested for only that device
         // If the command is requested for other devices as well, remove this device from the list of requesting devices
+        const DeviceModel::DeviceSet devices = d->deviceModel->deviceSet(d->deviceModel->getDevice(deviceID));
+        if (devices != 0) {
+            d->removeDevices(devices);
+        }
+        // Anything left is still for other devices, so carry on once the current command is done
+        if (remainingTime > -1) {
+            d->schedulePop(remainingTime);
+        }
     }
     Q_EMIT countChanged(count());
 }
 
 void CommandQueue::pushPause(int durationMilliseconds, QStringList devices)
+{
+    pushPause(durationMilliseconds, d->deviceModel->deviceSet(devices));
+}
+
+void CommandQueue::pushPause(int durationMilliseconds, DeviceModel::DeviceSet devices)
 {
     qDebug() << "Adding a pause to the queue of" << durationMilliseconds << "milliseconds";
     CommandInfo command;
@@ -190,18 +282,23 @@ void CommandQueue::pushPause(int durationMilliseconds, QStringList devices)
     command.duration = durationMilliseconds;
 
     Private::Entry* entry = new Private::Entry(command);
-    entry->deviceIDs = devices;
+    entry->devices = devices;
     d->commands.append(entry);
     Q_EMIT countChanged(count());
 
     // If we have just pushed a command and the timer is not currently running,
     // let's fire one off now!
-    if(!d->popTimer->isActive()) {
+    if(!d->isWaiting()) {
         d->pop();
     }
 }
 
 void CommandQueue::pushCommand(QString tailCommand, QStringList devices)
+{
+    pushCommand(tailCommand, d->deviceModel->deviceSet(devices));
+}
+
+void CommandQueue::pushCommand(const QString& tailCommand, DeviceModel::DeviceSet devices)
 {
     qDebug() << Q_FUNC_INFO << tailCommand;
     const CommandInfo& command = qobject_cast<CommandModel *>(d->connectionManager->commandModel())->getCommand(tailCommand);
@@ -209,39 +306,43 @@ void CommandQueue::pushCommand(QString tailCommand, QStringList devices)
     if(!command.isValid()) {
         return;
     }
+    CommandTracer::instance()->instant("CommandQueue::pushCommand", tailCommand);
     Private::Entry* entry = new Private::Entry(command);
-    entry->deviceIDs = devices;
+    entry->devices = devices;
     d->commands.append(entry);
     Q_EMIT countChanged(count());
 
     // If we have just pushed a command and the timer is not currently running,
     // let's fire one off now!
-    if(!d->popTimer->isActive()) {
+    if(!d->isWaiting()) {
         d->pop();
     }
 }
 
-void CommandQueue::pushCommands(CommandInfoList commands, QStringList devices)
+void CommandQueue::pushCommands(CommandInfoList commands, QStringList deviceIDs)
 {
     if(commands.count() > 0) {
+        const DeviceModel::DeviceSet devices = d->deviceModel->deviceSet(deviceIDs);
         for (const CommandInfo& command : commands) {
+            CommandTracer::instance()->instant("CommandQueue::pushCommand", command.command);
             Private::Entry* entry = new Private::Entry(command);
-            entry->deviceIDs = devices;
+            entry->devices = devices;
             d->commands.append(entry);
         }
         Q_EMIT countChanged(count());
 
         // If we have just pushed some commands and the timer is not currently
         // running, let's fire one off now!
-        if(!d->popTimer->isActive()) {
+        if(!d->isWaiting()) {
             d->pop();
         }
     }
 }
 
-void CommandQueue::pushCommands(QStringList commands, QStringList devices)
+void CommandQueue::pushCommands(QStringList commands, QStringList deviceIDs)
 {
     qDebug() << commands;
+    const DeviceModel::DeviceSet devices = d->deviceModel->deviceSet(deviceIDs);
     for (auto command : commands) {
         static const QLatin1String pauseString{"pause"};
         if(command.startsWith(pauseString)) {
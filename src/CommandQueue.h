@@ -19,10 +19,12 @@
 #define COMMANDQUEUE_H
 
 #include <QAbstractListModel>
+#include "DeviceModel.h"
 #include "GearCommandModel.h"
 #include "rep_CommandQueueProxy_source.h"
 
 class BTConnectionManager;
+class DeadlineScheduler;
 
 /**
  * @brief The main move and light command interface for the tails
@@ -57,6 +59,13 @@ public:
     int rowCount(const QModelIndex& parent = QModelIndex()) const;
     int count() const override;
 
+    /**
+     * Set the scheduler used to time the commands in the queue. By default this
+     * is DeadlineScheduler::instance().
+     * @param scheduler The scheduler to use (not taken ownership of)
+     */
+    void setScheduler(DeadlineScheduler* scheduler);
+
     /**
      * The number of remaining milliseconds of the most recently launched command
      * launched by the queue. If this is zero, consider no command running.
@@ -80,6 +89,13 @@ public:
      * @param devices The devices you wish to send the commands to (or an empty list to send to all devices)
      */
     Q_SLOT void pushPause(int durationMilliseconds, QStringList devices) override;
+    /**
+     * Add a pause to the end of the queue
+     *
+     * @param durationMilliseconds The duration of the pause in milliseconds
+     * @param devices The set of devices the pause is for
+     */
+    void pushPause(int durationMilliseconds, DeviceModel::DeviceSet devices);
     /**
      * Add a specific command to the end of the queue. If there are no commands
      * currently running, the command will be run immediately.
@@ -88,6 +104,14 @@ public:
      * @param devices The devices you wish to send the commands to (or an empty list to send to all devices)
      */
     Q_SLOT void pushCommand(QString tailCommand, QStringList devices) override;
+    /**
+     * Add a specific command to the end of the queue. If there are no commands
+     * currently running, the command will be run immediately.
+     *
+     * @param tailCommand The command you wish to add to the queue
+     * @param devices The set of devices you wish to send the command to
+     */
+    void pushCommand(const QString& tailCommand, DeviceModel::DeviceSet devices);
     /**
      * A convenient way of adding a whole list of commands to the queue in one go.
      * As with adding a single command, if nothing is currently running, once the
@@ -0,0 +1,169 @@
+/*
+ *   Copyright 2026 Dan Leinir Turthra Jensen <admin@leinir.dk>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 3, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Library General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public License
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>
+ */
+
+#include "CommandTracer.h"
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QVector>
+
+class CommandTracer::Private {
+public:
+    Private() {}
+    ~Private() {}
+    struct TracePoint {
+        qint64 timestamp{0}; // microseconds since the tracer was enabled
+        char phase{'i'};
+        const char* stage{nullptr};
+        QString command;
+        QString deviceID;
+    };
+    // Enough for a good few minutes of a busy show
+    static constexpr int capacity{4096};
+    QVector<TracePoint> tracePoints;
+    int next{0};
+    int count{0};
+    QElapsedTimer clock;
+};
+
+CommandTracer* CommandTracer::instance()
+{
+    static CommandTracer tracer;
+    return &tracer;
+}
+
+CommandTracer::CommandTracer()
+    : d(new Private)
+{
+}
+
+CommandTracer::~CommandTracer()
+{
+    delete d;
+}
+
+void CommandTracer::setEnabled(bool enabled)
+{
+    if (this->enabled != enabled) {
+        this->enabled = enabled;
+        clear();
+        if (enabled) {
+            d->tracePoints.resize(Private::capacity);
+            d->clock.start();
+        } else {
+            d->tracePoints.clear();
+            d->tracePoints.squeeze();
+        }
+    }
+}
+
+void CommandTracer::instant(const char* stage, const QString& command, const QString& deviceID)
+{
+    if (enabled) {
+        record('i', stage, command, deviceID);
+    }
+}
+
+void CommandTracer::begin(const QString& command, const QString& deviceID)
+{
+    if (enabled) {
+        record('B', "running", command, deviceID);
+    }
+}
+
+void CommandTracer::end(const QString& command, const QString& deviceID)
+{
+    if (enabled) {
+        record('E', "running", command, deviceID);
+    }
+}
+
+void CommandTracer::record(char phase, const char* stage, const QString& command, const QString& deviceID)
+{
+    Private::TracePoint& tracePoint = d->tracePoints[d->next];
+    tracePoint.timestamp = d->clock.nsecsElapsed() / 1000;
+    tracePoint.phase = phase;
+    tracePoint.stage = stage;
+    tracePoint.command = command;
+    tracePoint.deviceID = deviceID;
+    d->next = (d->next + 1) % Private::capacity;
+    d->count = qMin(d->count + 1, int(Private::capacity));
+}
+
+void CommandTracer::clear()
+{
+    d->next = 0;
+    d->count = 0;
+}
+
+QByteArray CommandTracer::toChromeTraceJson() const
+{
+    QJsonArray events;
+    // Each device gets its own track (a "thread" in trace terms), and track 0 is for everything else
+    QHash<QString, int> tracks;
+    QJsonObject queueTrackName{{QStringLiteral("name"), QStringLiteral("Command Queue")}};
+    events.append(QJsonObject{
+        {QStringLiteral("name"), QStringLiteral("thread_name")},
+        {QStringLiteral("ph"), QStringLiteral("M")},
+        {QStringLiteral("pid"), 1},
+        {QStringLiteral("tid"), 0},
+        {QStringLiteral("args"), queueTrackName},
+    });
+    const int first = (d->next - d->count + Private::capacity) % Private::capacity;
+    for (int i = 0; i < d->count; ++i) {
+        const Private::TracePoint& tracePoint = d->tracePoints.at((first + i) % Private::capacity);
+        int track{0};
+        if (!tracePoint.deviceID.isEmpty()) {
+            track = tracks.value(tracePoint.deviceID, -1);
+            if (track == -1) {
+                track = tracks.count() + 1;
+                tracks[tracePoint.deviceID] = track;
+                events.append(QJsonObject{
+                    {QStringLiteral("name"), QStringLiteral("thread_name")},
+                    {QStringLiteral("ph"), QStringLiteral("M")},
+                    {QStringLiteral("pid"), 1},
+                    {QStringLiteral("tid"), track},
+                    {QStringLiteral("args"), QJsonObject{{QStringLiteral("name"), tracePoint.deviceID}}},
+                });
+            }
+        }
+        QJsonObject event{
+            {QStringLiteral("cat"), QStringLiteral("command")},
+            {QStringLiteral("ph"), QString{QLatin1Char{tracePoint.phase}}},
+            {QStringLiteral("ts"), tracePoint.timestamp},
+            {QStringLiteral("pid"), 1},
+            {QStringLiteral("tid"), track},
+            {QStringLiteral("args"), QJsonObject{{QStringLiteral("stage"), QString::fromLatin1(tracePoint.stage)}, {QStringLiteral("command"), tracePoint.command}}},
+        };
+        if (tracePoint.phase == 'i') {
+            event[QStringLiteral("name")] = QString::fromLatin1(tracePoint.stage);
+            // Show instant events only on their own track, rather than across the whole process
+            event[QStringLiteral("s")] = QStringLiteral("t");
+        } else {
+            // Running commands show up as a bar named after the command
+            event[QStringLiteral("name")] = tracePoint.command;
+        }
+        events.append(event);
+    }
+    return QJsonDocument(QJsonObject{
+        {QStringLiteral("traceEvents"), events},
+        {QStringLiteral("displayTimeUnit"), QStringLiteral("ms")},
+    }).toJson(QJsonDocument::Compact);
+}
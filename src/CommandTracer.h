@@ -0,0 +1,77 @@
+/*
+ *   Copyright 2026 Dan Leinir Turthra Jensen <admin@leinir.dk>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 3, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Library General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public License
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>
+ */
+
+#ifndef COMMANDTRACER_H
+#define COMMANDTRACER_H
+
+#include <QString>
+
+/**
+ * Records timestamped trace points along the path a command takes, from being
+ * pushed onto the command queue until the gear tells us it has finished
+ * running it, so we can see where the time between a tap and the gear moving
+ * goes.
+ *
+ * The trace points are kept in a fixed size ring buffer, so only the most
+ * recent ones are available, and tracing costs nothing beyond a check of
+ * isEnabled() while it is switched off (which it is unless developer mode
+ * is enabled).
+ */
+class CommandTracer
+{
+public:
+    static CommandTracer* instance();
+
+    bool isEnabled() const { return enabled; }
+    /**
+     * Switch tracing on or off. Switching it off also clears any recorded trace points.
+     */
+    void setEnabled(bool enabled);
+
+    /**
+     * Record that a command passed through a particular stage
+     * @param stage The name of the stage, which must be a string literal (or otherwise outlive the tracer)
+     * @param command The command being traced
+     * @param deviceID The ID of the device the stage relates to, if any
+     */
+    void instant(const char* stage, const QString& command, const QString& deviceID = QString{});
+    /**
+     * Record that a device started running a command. Match with a call to end
+     */
+    void begin(const QString& command, const QString& deviceID);
+    /**
+     * Record that a device finished running a command
+     */
+    void end(const QString& command, const QString& deviceID);
+
+    void clear();
+    /**
+     * The recorded trace points, in the Chrome trace event format (loadable in
+     * chrome://tracing, Perfetto and similar). Each device gets its own track,
+     * and stages which aren't tied to a specific device go on a track of their own.
+     */
+    QByteArray toChromeTraceJson() const;
+private:
+    CommandTracer();
+    ~CommandTracer();
+    void record(char phase, const char* stage, const QString& command, const QString& deviceID);
+    bool enabled{false};
+    class Private;
+    Private* d;
+};
+
+#endif//COMMANDTRACER_H
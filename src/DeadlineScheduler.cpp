@@ -0,0 +1,206 @@
+/*
+ *   Copyright 2026 Dan Leinir Turthra Jensen <admin@leinir.dk>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 3, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Library General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public License
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>
+ */
+
+#include "DeadlineScheduler.h"
+#include "Clock.h"
+
+#include <QCoreApplication>
+#include <QHash>
+#include <QPointer>
+#include <QTimer>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+class DeadlineScheduler::Private {
+public:
+    Private(DeadlineScheduler* q, Clock* clock)
+        : q(q)
+        , clock(clock ? clock : Clock::system())
+    {}
+    ~Private() {}
+    DeadlineScheduler* q{nullptr};
+
+    struct HeapEntry {
+        qint64 deadline;
+        Handle handle;
+        // std::push_heap and friends build a max-heap, so invert the comparison to get the earliest deadline on top
+        bool operator<(const HeapEntry& other) const {
+            return deadline > other.deadline || (deadline == other.deadline && handle > other.handle);
+        }
+    };
+    struct Pending {
+        qint64 deadline;
+        QPointer<QObject> context;
+        std::function<void()> callback;
+    };
+    // Deadlines this close after the earliest one are run in the same wakeup, by waking up a little late for the earliest
+    static constexpr qint64 coalesceWindow{10};
+
+    std::vector<HeapEntry> heap;
+    // Only the deadlines which have not been cancelled are in here, and anything in the heap which isn't gets skipped
+    QHash<Handle, Pending> pending;
+    Handle nextHandle{1};
+    Clock* clock{nullptr};
+    QTimer timer;
+
+    qint64 now() const {
+        return clock->elapsed();
+    }
+
+    void dropCancelled() {
+        while (!heap.empty() && !pending.contains(heap.front().handle)) {
+            std::pop_heap(heap.begin(), heap.end());
+            heap.pop_back();
+        }
+        // Don't let cancelled deadlines pile up in the heap if lots of them are far in the future
+        if (heap.size() > 64 && heap.size() > size_t(pending.count()) * 2) {
+            heap.erase(std::remove_if(heap.begin(), heap.end(), [this](const HeapEntry& entry){ return !pending.contains(entry.handle); }), heap.end());
+            std::make_heap(heap.begin(), heap.end());
+        }
+    }
+
+    // The latest deadline which is no more than the coalescing window after the earliest one. Any entry in
+    // the heap is no earlier than its parent, so only the part of the heap inside the window needs looking at.
+    qint64 coalescedDeadline() const {
+        const qint64 limit = heap.front().deadline + coalesceWindow;
+        qint64 latest = heap.front().deadline;
+        std::vector<size_t> stack{0};
+        while (!stack.empty()) {
+            const size_t index = stack.back();
+            stack.pop_back();
+            if (pending.contains(heap[index].handle)) {
+                latest = qMax(latest, heap[index].deadline);
+            }
+            for (const size_t child : {2 * index + 1, 2 * index + 2}) {
+                if (child < heap.size() && heap[child].deadline <= limit) {
+                    stack.push_back(child);
+                }
+            }
+        }
+        return latest;
+    }
+
+    void arm() {
+        dropCancelled();
+        if (heap.empty()) {
+            timer.stop();
+        } else {
+            timer.start(int(qBound<qint64>(0, coalescedDeadline() - now(), std::numeric_limits<int>::max())));
+        }
+    }
+
+    void runDue() {
+        const qint64 cutoff = now();
+        QList<Handle> due;
+        dropCancelled();
+        while (!heap.empty() && heap.front().deadline <= cutoff) {
+            due << heap.front().handle;
+            std::pop_heap(heap.begin(), heap.end());
+            heap.pop_back();
+            dropCancelled();
+        }
+        // Run the callbacks only once we're done with the heap, as they are quite likely to schedule something new.
+        // The deadlines stay pending until their turn comes, so an earlier callback can still cancel them.
+        for (const Handle handle : std::as_const(due)) {
+            auto it = pending.find(handle);
+            if (it == pending.end()) {
+                continue;
+            }
+            const Pending entry = it.value();
+            pending.erase(it);
+            if (entry.context) {
+                entry.callback();
+            }
+        }
+        arm();
+    }
+};
+
+DeadlineScheduler* DeadlineScheduler::instance()
+{
+    static QPointer<DeadlineScheduler> scheduler;
+    if (!scheduler) {
+        scheduler = new DeadlineScheduler(QCoreApplication::instance());
+    }
+    return scheduler;
+}
+
+DeadlineScheduler::DeadlineScheduler(QObject* parent)
+    : DeadlineScheduler(nullptr, parent)
+{
+}
+
+DeadlineScheduler::DeadlineScheduler(Clock* clock, QObject* parent)
+    : QObject(parent)
+    , d(new Private(this, clock))
+{
+    d->timer.setSingleShot(true);
+    d->timer.setTimerType(Qt::PreciseTimer);
+    connect(&d->timer, &QTimer::timeout, this, [this](){ d->runDue(); });
+}
+
+DeadlineScheduler::~DeadlineScheduler()
+{
+    delete d;
+}
+
+DeadlineScheduler::Handle DeadlineScheduler::schedule(int milliseconds, QObject* context, std::function<void()> callback)
+{
+    const Handle handle = d->nextHandle++;
+    const qint64 deadline = d->now() + qMax(0, milliseconds);
+    d->pending.insert(handle, Private::Pending{deadline, context, std::move(callback)});
+    d->heap.push_back(Private::HeapEntry{deadline, handle});
+    std::push_heap(d->heap.begin(), d->heap.end());
+    // Only need to touch the timer if this is now the earliest deadline
+    if (d->heap.front().handle == handle) {
+        d->arm();
+    }
+    return handle;
+}
+
+void DeadlineScheduler::cancel(Handle handle)
+{
+    // The heap entry is left where it is, and skipped once it reaches the top
+    d->pending.remove(handle);
+}
+
+void DeadlineScheduler::reschedule(Handle& handle, int milliseconds, QObject* context, std::function<void()> callback)
+{
+    cancel(handle);
+    handle = schedule(milliseconds, context, std::move(callback));
+}
+
+bool DeadlineScheduler::isScheduled(Handle handle) const
+{
+    return d->pending.contains(handle);
+}
+
+int DeadlineScheduler::remainingTime(Handle handle) const
+{
+    auto it = d->pending.constFind(handle);
+    if (it == d->pending.constEnd()) {
+        return -1;
+    }
+    return int(qMax<qint64>(0, it.value().deadline - d->now()));
+}
+
+Clock* DeadlineScheduler::clock() const
+{
+    return d->clock;
+}
@@ -0,0 +1,101 @@
+/*
+ *   Copyright 2026 Dan Leinir Turthra Jensen <admin@leinir.dk>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 3, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Library General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public License
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>
+ */
+
+#ifndef DEADLINESCHEDULER_H
+#define DEADLINESCHEDULER_H
+
+#include <QObject>
+
+#include <functional>
+
+class Clock;
+
+/**
+ * A single service-wide place to register things which need doing at some
+ * point in the future (watchdogs, retries, and the like), all run off a
+ * single underlying timer, rather than each creating their own QTimer.
+ *
+ * Deadlines are kept in a min-heap, and cancelling one simply forgets about
+ * it, so both scheduling and cancelling are cheap. Deadlines which fall
+ * within a few milliseconds after the earliest one are run together with it,
+ * by waking up for the last of them, so deadlines which are close together
+ * only cause a single wakeup. A deadline is never run early.
+ *
+ * Time is read from a Clock, which is the system clock unless told otherwise.
+ */
+class DeadlineScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * A handle identifying a scheduled deadline. Handles are never reused, and
+     * 0 is never a valid handle, so it can be used to mean "nothing scheduled".
+     */
+    typedef quint64 Handle;
+
+    /**
+     * The scheduler used throughout the service
+     */
+    static DeadlineScheduler* instance();
+
+    explicit DeadlineScheduler(QObject* parent = nullptr);
+    /**
+     * Create a scheduler which reads the time from the given clock
+     * @param clock The clock to use (not taken ownership of)
+     */
+    explicit DeadlineScheduler(Clock* clock, QObject* parent = nullptr);
+    ~DeadlineScheduler() override;
+
+    /**
+     * Call the callback once the given time has passed. If the context object
+     * is destroyed before then, the callback is dropped.
+     * @param milliseconds How long from now to call the callback
+     * @param context The object the callback belongs to
+     * @param callback The function to call
+     * @return A handle which can be used to cancel the deadline
+     */
+    Handle schedule(int milliseconds, QObject* context, std::function<void()> callback);
+    /**
+     * Cancel the deadline with the given handle. Cancelling a deadline which
+     * has already run (or a handle of 0) does nothing.
+     * @param handle The handle of the deadline to cancel
+     */
+    void cancel(Handle handle);
+    /**
+     * Cancel the given deadline (if any), and schedule the callback anew, storing
+     * the new handle in place of the old one
+     */
+    void reschedule(Handle& handle, int milliseconds, QObject* context, std::function<void()> callback);
+    /**
+     * Whether the deadline with the given handle is still waiting to run
+     */
+    bool isScheduled(Handle handle) const;
+    /**
+     * The number of milliseconds until the deadline with the given handle runs, or -1 if it is not scheduled
+     */
+    int remainingTime(Handle handle) const;
+
+    /**
+     * The clock this scheduler reads the time from
+     */
+    Clock* clock() const;
+private:
+    class Private;
+    Private* d;
+};
+
+#endif//DEADLINESCHEDULER_H
@@ -17,6 +17,9 @@
 
 #include "DeviceModel.h"
 #include "AppSettings.h"
+#include "CommandTracer.h"
+#include "DeadlineScheduler.h"
+#include "HeartbeatScheduler.h"
 #include "GearBase.h"
 #include "gearimplementations/GearDigitail.h"
 #include "gearimplementations/GearEars.h"
@@ -27,6 +30,13 @@
 
 #include <KLocalizedString>
 #include <QColor>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMetaMethod>
+#include <QPointer>
+#include <QSet>
+#include <QtAlgorithms>
+#include <QTimer>
 
 class DeviceModel::Private
 {
@@ -41,13 +51,320 @@ public:
 
     AppSettings* appSettings{nullptr};
     QList<GearBase*> devices;
+    // Discovery reports the same devices over and over again, so keep track of what we already know
+    // about by address, and avoid having to construct a gear object to find out again
+    QHash<quint64, GearBase*> devicesByAddress;
+    QSet<quint64> rejectedAddresses;
+
+    // Everything we need to find a device quickly, kept up to date as devices come and go
+    struct DeviceIndex {
+        QString deviceID;
+        quint64 address{0};
+        int row{-1};
+        int slot{-1};
+    };
+    QHash<GearBase*, DeviceIndex> deviceIndices;
+    QHash<QString, GearBase*> devicesByID;
+    // The device which holds each bit of a DeviceSet. Only connected devices hold one (a message to anything
+    // else would go nowhere anyway), so everything we see during discovery doesn't use them all up.
+    GearBase* deviceSlots[DeviceModel::MaxDeviceSetSlots]{};
+
+    // Returns the device's slot, giving it one first if it is connected and doesn't have one yet
+    int acquireSlot(GearBase* device)
+    {
+        auto it = deviceIndices.find(device);
+        if (it == deviceIndices.end()) {
+            return -1;
+        }
+        if (it->slot == -1 && device->isConnected()) {
+            for (int slot = 0; slot < DeviceModel::MaxDeviceSetSlots; ++slot) {
+                if (deviceSlots[slot] == nullptr) {
+                    deviceSlots[slot] = device;
+                    it->slot = slot;
+                    break;
+                }
+            }
+            if (it->slot == -1) {
+                qWarning() << "Ran out of device set slots, so" << it->deviceID << "can only be reached when sending to all devices";
+            }
+        }
+        return it->slot;
+    }
+
+    void releaseSlot(GearBase* device)
+    {
+        auto it = deviceIndices.find(device);
+        if (it != deviceIndices.end() && it->slot > -1) {
+            deviceSlots[it->slot] = nullptr;
+            it->slot = -1;
+        }
+    }
+
+    void indexDevice(GearBase* device)
+    {
+        DeviceIndex index;
+        index.deviceID = device->deviceID();
+        index.address = device->deviceInfo.address().toUInt64();
+        deviceIndices.insert(device, index);
+        devicesByID.insert(index.deviceID, device);
+        devicesByAddress.insert(index.address, device);
+        updateRows();
+    }
+
+    // This is also called for devices which are being destroyed, so it must not touch the device itself
+    void unindexDevice(GearBase* device)
+    {
+        const DeviceIndex index = deviceIndices.take(device);
+        if (index.row > -1) {
+            devicesByID.remove(index.deviceID);
+            dirtyRoles.remove(device);
+            devicesByAddress.remove(index.address);
+            if (index.slot > -1) {
+                deviceSlots[index.slot] = nullptr;
+            }
+        }
+    }
+
+    void updateRows()
+    {
+        for (int row = 0; row < devices.count(); ++row) {
+            deviceIndices[devices[row]].row = row;
+        }
+    }
+
+    // The gear waiting for a connection slot, and the gear currently holding one
+    QList<GearBase*> queuedConnections;
+    QList<GearBase*> connectionsInFlight;
+    int connectionBatchTotal{0};
+    int connectionBatchCompleted{0};
+    // If a connection attempt has not resolved itself after this long, let something else have a go
+    static const int connectionAttemptTimeout{20000};
+    QHash<GearBase*, DeadlineScheduler::Handle> connectionAttemptDeadlines;
+
+    void queueConnection(GearBase* device)
+    {
+        if (queuedConnections.contains(device) || connectionsInFlight.contains(device)) {
+            return;
+        }
+        queuedConnections << device;
+        ++connectionBatchTotal;
+        Q_EMIT q->connectionProgress(connectionBatchCompleted, connectionBatchTotal);
+        startQueuedConnections();
+    }
+
+    void startQueuedConnections()
+    {
+        const int maxConnections = qMax(1, appSettings ? appSettings->maxConcurrentConnections() : 3);
+        while (connectionsInFlight.count() < maxConnections && !queuedConnections.isEmpty()) {
+            GearBase* device = queuedConnections.takeFirst();
+            if (device->isConnected()) {
+                completeConnection();
+                continue;
+            }
+            qDebug() << device->name() << device->deviceID() << "Starting queued connection attempt," << queuedConnections.count() << "more waiting";
+            connectionsInFlight << device;
+            connectionAttemptDeadlines[device] = DeadlineScheduler::instance()->schedule(connectionAttemptTimeout, device, [this, device](){ releaseConnectionSlot(device); });
+            device->connectDevice();
+        }
+    }
+
+    void releaseConnectionSlot(GearBase* device)
+    {
+        DeadlineScheduler::instance()->cancel(connectionAttemptDeadlines.take(device));
+        if (connectionsInFlight.removeAll(device) > 0) {
+            completeConnection();
+            startQueuedConnections();
+        }
+    }
+
+    void completeConnection()
+    {
+        ++connectionBatchCompleted;
+        Q_EMIT q->connectionProgress(connectionBatchCompleted, connectionBatchTotal);
+        if (queuedConnections.isEmpty() && connectionsInFlight.isEmpty()) {
+            connectionBatchTotal = 0;
+            connectionBatchCompleted = 0;
+        }
+    }
+
+    void forgetConnection(GearBase* device)
+    {
+        DeadlineScheduler::instance()->cancel(connectionAttemptDeadlines.take(device));
+        const bool wasPending = (queuedConnections.removeAll(device) + connectionsInFlight.removeAll(device)) > 0;
+        if (wasPending) {
+            completeConnection();
+            startQueuedConnections();
+        }
+    }
+
+    // Role changes are collected per device, and sent out as a single dataChanged per device
+    // once we get back to the event loop, as each one is sent across to the UI separately
+    struct DirtyRoles {
+        QList<int> roles;
+        // When each of the rate limited roles was last sent out for this device
+        QHash<int, qint64> lastFlushed;
+    };
+    QHash<GearBase*, DirtyRoles> dirtyRoles;
+    QTimer flushTimer;
+    QElapsedTimer clock;
+
+    // Which roles are changed when a device emits a signal with the given name
+    static const QHash<QByteArray, QList<int>>& propertyTable()
+    {
+        static const QHash<QByteArray, QList<int>> table{
+            {"nameChanged", {DeviceModel::Name}},
+            {"versionChanged", {DeviceModel::DeviceVersion}},
+            {"batteryLevelChanged", {DeviceModel::BatteryLevel}},
+            {"currentCallChanged", {DeviceModel::CurrentCall}},
+            {"activeCommandTitlesChanged", {DeviceModel::ActiveCommandTitles}},
+            {"checkedChanged", {DeviceModel::Checked}},
+            {"enabledCommandsFilesChanged", {DeviceModel::EnabledCommandsFiles}},
+            {"supportsOTAChanged", {DeviceModel::SupportsOTA}},
+            {"hasAvailableOTAChanged", {DeviceModel::HasAvailableOTA, DeviceModel::OTAVersion}},
+            {"hasOTADataChanged", {DeviceModel::HasOTAData}},
+            {"deviceProgressChanged", {DeviceModel::DeviceProgress, DeviceModel::OperationInProgress}},
+            {"progressDescriptionChanged", {DeviceModel::ProgressDescription}},
+            {"hasLightsChanged", {DeviceModel::HasLights}},
+            {"hasShutdownChanged", {DeviceModel::HasShutdown}},
+            {"hasNoPhoneModeChanged", {DeviceModel::HasNoPhoneMode}},
+            {"noPhoneModeGroupsChanged", {DeviceModel::NoPhoneModeGroups}},
+            {"chargingStateChanged", {DeviceModel::ChargingState}},
+            {"batteryLevelPercentChanged", {DeviceModel::BatteryLevelPercent}},
+            {"knownFirmwareMessageChanged", {DeviceModel::KnownFirmwareMessage}},
+            {"gearSensorCommandDetailsChanged", {DeviceModel::GestureEventValues, DeviceModel::GestureEventTitles, DeviceModel::GestureEventCommands, DeviceModel::GestureEventDevices}},
+            {"supportedTiltEventsChanged", {DeviceModel::SupportedTiltEvents}},
+            {"supportedSoundEventsChanged", {DeviceModel::SupportedSoundEvents}},
+            {"colorChanged", {DeviceModel::Color}},
+            {"isConnectingChanged", {DeviceModel::IsConnecting}},
+            {"autoConnectChanged", {DeviceModel::AutoConnect}},
+            {"isKnownChanged", {DeviceModel::IsKnown}},
+            {"timeToReadyChanged", {DeviceModel::TimeToReady}},
+            {"signalStrengthChanged", {DeviceModel::SignalStrength}},
+            // GearEars
+            {"listenModeChanged", {DeviceModel::ListeningState}},
+            {"micsSwappedChanged", {DeviceModel::MicsSwapped}},
+            {"hasTiltChanged", {DeviceModel::HasTilt}},
+            {"canBalanceListeningChanged", {DeviceModel::CanBalanceListening}},
+            {"tiltEnabledChanged", {DeviceModel::TiltEnabled}},
+        };
+        return table;
+    }
+
+    // The property table resolved to signal indices, worked out once for each type of gear
+    QHash<const QMetaObject*, QHash<int, QList<int>>> signalRolesByType;
+    const QHash<int, QList<int>>& signalRoles(const QMetaObject* metaObject)
+    {
+        auto it = signalRolesByType.find(metaObject);
+        if (it == signalRolesByType.end()) {
+            QHash<int, QList<int>> signalRoles;
+            const QHash<QByteArray, QList<int>>& table = propertyTable();
+            for (int i = 0; i < metaObject->methodCount(); ++i) {
+                const QMetaMethod method = metaObject->method(i);
+                if (method.methodType() == QMetaMethod::Signal && table.contains(method.name())) {
+                    signalRoles.insert(i, table.value(method.name()));
+                }
+            }
+            it = signalRolesByType.insert(metaObject, signalRoles);
+        }
+        return it.value();
+    }
+
+    // The number of roles we keep in the per-device snapshot, which must fit in its bitmask
+    static constexpr int snapshotSize{DeviceModel::SignalStrength - DeviceModel::Name + 1};
+    static_assert(snapshotSize <= 64, "The device model's roles no longer fit in the snapshot mask");
+    static QVariant deviceData(GearBase* device, int role);
+    // Most roles are asked for much more often than they change, so only work them out when they do
+    static QVariant snapshotData(GearBase* device, int role)
+    {
+        const int snapshotIndex = role - DeviceModel::Name;
+        if (snapshotIndex < 0 || snapshotIndex >= snapshotSize) {
+            return QVariant{};
+        }
+        GearBase::ModelSnapshot* snapshot = device->modelSnapshot();
+        const quint64 roleBit = quint64{1} << snapshotIndex;
+        if (!(snapshot->validRoles & roleBit)) {
+            if (snapshot->values.count() < snapshotSize) {
+                snapshot->values.resize(snapshotSize);
+            }
+            snapshot->values[snapshotIndex] = deviceData(device, role);
+            snapshot->validRoles |= roleBit;
+        }
+        return snapshot->values.at(snapshotIndex);
+    }
 
     void notifyDeviceDataChanged(GearBase* device, int role)
     {
-        int pos = devices.indexOf(device);
-        if(pos > -1) {
-            QModelIndex idx(q->index(pos));
-            q->dataChanged(idx, idx, QVector<int>{role});
+        const int snapshotIndex = role - DeviceModel::Name;
+        if (snapshotIndex > -1 && snapshotIndex < snapshotSize) {
+            device->modelSnapshot()->validRoles &= ~(quint64{1} << snapshotIndex);
+        }
+        QList<int>& roles = dirtyRoles[device].roles;
+        if (!roles.contains(role)) {
+            roles << role;
+        }
+        // The timer may be waiting for a rate limited role to be allowed out again, which is no reason to hold back anything else
+        if (!flushTimer.isActive() || roleRateLimit(role) == 0) {
+            flushTimer.start(0);
+        }
+    }
+
+    // How often (in milliseconds) the chattiest roles are allowed to be sent out per device
+    static int roleRateLimit(int role)
+    {
+        switch(role) {
+            case DeviceModel::BatteryLevel:
+            case DeviceModel::BatteryLevelPercent:
+                return 1000;
+            case DeviceModel::DeviceProgress:
+                return 250;
+            default:
+                return 0;
+        }
+    }
+
+    void flushDeviceDataChanged()
+    {
+        const qint64 now = clock.elapsed();
+        qint64 nextFlush{-1};
+        QMutableHashIterator<GearBase*, DirtyRoles> it(dirtyRoles);
+        while (it.hasNext()) {
+            it.next();
+            DirtyRoles& dirty = it.value();
+            // Once a rate limited role's window has passed, it doesn't matter when it was last sent out
+            QMutableHashIterator<int, qint64> flushedIt(dirty.lastFlushed);
+            while (flushedIt.hasNext()) {
+                flushedIt.next();
+                if (flushedIt.value() + roleRateLimit(flushedIt.key()) <= now) {
+                    flushedIt.remove();
+                }
+            }
+            QList<int> roles;
+            for (int i = dirty.roles.count() - 1; i > -1; --i) {
+                const int role = dirty.roles.at(i);
+                const int rateLimit = roleRateLimit(role);
+                if (rateLimit > 0) {
+                    const qint64 due = dirty.lastFlushed.value(role, -rateLimit) + rateLimit;
+                    if (due > now) {
+                        // Hang on to this one until it's allowed out again
+                        nextFlush = nextFlush == -1 ? due : qMin(nextFlush, due);
+                        continue;
+                    }
+                    dirty.lastFlushed[role] = now;
+                }
+                roles << role;
+                dirty.roles.removeAt(i);
+            }
+            const int pos = deviceIndices.value(it.key()).row;
+            if (pos > -1 && !roles.isEmpty()) {
+                QModelIndex idx(q->index(pos));
+                q->dataChanged(idx, idx, roles);
+            }
+            if (dirty.roles.isEmpty() && dirty.lastFlushed.isEmpty()) {
+                it.remove();
+            }
+        }
+        if (nextFlush > -1) {
+            flushTimer.start(int(nextFlush - now));
         }
     }
 };
@@ -57,6 +374,10 @@ DeviceModel::DeviceModel(QObject* parent)
     , d(new Private(this))
 {
     d->fakeDevice = new GearFake(QBluetoothDeviceInfo(QBluetoothAddress(QLatin1String{"00:00:FA:CE:7A:1E"}), QLatin1String{"FAKE"}, 0), this);
+    new HeartbeatScheduler(this);
+    d->clock.start();
+    d->flushTimer.setSingleShot(true);
+    connect(&d->flushTimer, &QTimer::timeout, this, [this](){ d->flushDeviceDataChanged(); });
 }
 
 DeviceModel::~DeviceModel()
@@ -128,6 +449,8 @@ QHash< int, QByteArray > DeviceModel::roleNames() const
         {IsConnecting, "isConnecting"},
         {AutoConnect, "autoConnect"},
         {IsKnown, "isKnown"},
+        {TimeToReady, "timeToReady"},
+        {SignalStrength, "signalStrength"},
     };
     return roles;
 }
@@ -137,238 +460,249 @@ QVariant DeviceModel::data(const QModelIndex& index, int role) const
     QVariant value;
     if(index.isValid() && index.row() > -1 && index.row() < d->devices.count()) {
         GearBase* device = d->devices.at(index.row());
-        switch(role) {
-            case Name:
-                value = device->name();
-                break;
-            case DeviceID:
-                value = device->deviceID();
-                break;
-            case DeviceVersion:
-                value = device->version();
-                break;
-            case BatteryLevel:
-                value = device->batteryLevel();
-                break;
-            case CurrentCall:
-                value = device->currentCall();
-                break;
-            case IsConnected:
-                value = device->isConnected();
-                break;
-            case ActiveCommandTitles:
-                value = device->activeCommandTitles();
-                break;
-            case Checked:
-                value = device->checked();
-                break;
-            case HasListening:
-                value = (qobject_cast<GearEars*>(device) != nullptr);
-                break;
-            case ListeningState:
-            {
-                int listeningState = 0;
-                GearEars* ears = qobject_cast<GearEars*>(device);
-                if (ears) {
-                    listeningState = ears->listenMode();
-                }
-                value = listeningState;
-                break;
+        value = Private::snapshotData(device, role);
+    };
+    return value;
+}
+
+QVariant DeviceModel::Private::deviceData(GearBase* device, int role)
+{
+    QVariant value;
+    switch(role) {
+        case Name:
+            value = device->name();
+            break;
+        case DeviceID:
+            value = device->deviceID();
+            break;
+        case DeviceVersion:
+            value = device->version();
+            break;
+        case BatteryLevel:
+            value = device->batteryLevel();
+            break;
+        case CurrentCall:
+            value = device->currentCall();
+            break;
+        case IsConnected:
+            value = device->isConnected();
+            break;
+        case ActiveCommandTitles:
+            value = device->activeCommandTitles();
+            break;
+        case Checked:
+            value = device->checked();
+            break;
+        case HasListening:
+            value = (qobject_cast<GearEars*>(device) != nullptr);
+            break;
+        case ListeningState:
+        {
+            int listeningState = 0;
+            GearEars* ears = qobject_cast<GearEars*>(device);
+            if (ears) {
+                listeningState = ears->listenMode();
             }
-            case EnabledCommandsFiles:
-                value = device->enabledCommandsFiles();
-                break;
-            case MicsSwapped:
-            {
-                bool micsSwapped{false};
-                GearEars* ears = qobject_cast<GearEars*>(device);
-                if (ears) {
-                    micsSwapped = ears->micsSwapped();
-                }
-                value = micsSwapped;
-                break;
+            value = listeningState;
+            break;
+        }
+        case EnabledCommandsFiles:
+            value = device->enabledCommandsFiles();
+            break;
+        case MicsSwapped:
+        {
+            bool micsSwapped{false};
+            GearEars* ears = qobject_cast<GearEars*>(device);
+            if (ears) {
+                micsSwapped = ears->micsSwapped();
             }
-            case SupportsOTA:
-                value = device->supportsOTA();
-                break;
-            case HasAvailableOTA:
-                value = device->hasAvailableOTA();
-                break;
-            case HasOTAData:
-                value = device->hasOTAData();
-                break;
-            case DeviceProgress:
-                value = device->deviceProgress();
-                break;
-            case ProgressDescription:
-                value = device->progressDescription();
-                break;
-            case OperationInProgress:
-                value = device->deviceProgress() > -1;
-                break;
-            case OTAVersion:
-                value = device->otaVersion();
-                break;
-            case HasLights:
-                value = device->hasLights();
-                break;
-            case HasShutdown:
-                value = device->hasShutdown();
-                break;
-            case HasNoPhoneMode:
-                value = device->hasNoPhoneMode();
-                break;
-            case NoPhoneModeGroups:
-                value = device->noPhoneModeGroups();
-                break;
-            case ChargingState:
-                value = device->chargingState();
-                break;
-            case BatteryLevelPercent:
-                value = device->batteryLevelPercent();
-                break;
-            case HasTilt:
-            {
-                bool hasTilt{false};
-                GearEars* ears = qobject_cast<GearEars*>(device);
-                if (ears) {
-                    hasTilt = ears->hasTilt();
-                }
-                value = hasTilt;
-                break;
+            value = micsSwapped;
+            break;
+        }
+        case SupportsOTA:
+            value = device->supportsOTA();
+            break;
+        case HasAvailableOTA:
+            value = device->hasAvailableOTA();
+            break;
+        case HasOTAData:
+            value = device->hasOTAData();
+            break;
+        case DeviceProgress:
+            value = device->deviceProgress();
+            break;
+        case ProgressDescription:
+            value = device->progressDescription();
+            break;
+        case OperationInProgress:
+            value = device->deviceProgress() > -1;
+            break;
+        case OTAVersion:
+            value = device->otaVersion();
+            break;
+        case HasLights:
+            value = device->hasLights();
+            break;
+        case HasShutdown:
+            value = device->hasShutdown();
+            break;
+        case HasNoPhoneMode:
+            value = device->hasNoPhoneMode();
+            break;
+        case NoPhoneModeGroups:
+            value = device->noPhoneModeGroups();
+            break;
+        case ChargingState:
+            value = device->chargingState();
+            break;
+        case BatteryLevelPercent:
+            value = device->batteryLevelPercent();
+            break;
+        case HasTilt:
+        {
+            bool hasTilt{false};
+            GearEars* ears = qobject_cast<GearEars*>(device);
+            if (ears) {
+                hasTilt = ears->hasTilt();
             }
-            case CanBalanceListening:
-            {
-                bool canBalanceListening{false};
-                GearEars* ears = qobject_cast<GearEars*>(device);
-                if (ears) {
-                    canBalanceListening = ears->canBalanceListening();
-                }
-                value = canBalanceListening;
-                break;
+            value = hasTilt;
+            break;
+        }
+        case CanBalanceListening:
+        {
+            bool canBalanceListening{false};
+            GearEars* ears = qobject_cast<GearEars*>(device);
+            if (ears) {
+                canBalanceListening = ears->canBalanceListening();
             }
-            case TiltEnabled:
-            {
-                bool tiltEnabled{false};
-                GearEars* ears = qobject_cast<GearEars*>(device);
-                if (ears) {
-                    tiltEnabled = ears->tiltEnabled();
-                }
-                value = tiltEnabled;
-                break;
+            value = canBalanceListening;
+            break;
+        }
+        case TiltEnabled:
+        {
+            bool tiltEnabled{false};
+            GearEars* ears = qobject_cast<GearEars*>(device);
+            if (ears) {
+                tiltEnabled = ears->tiltEnabled();
             }
-            case KnownFirmwareMessage:
-                value = device->knownFirmwareMessage();
-                break;
-            case GestureEventValues: {
-                static QVariantList gestureValues;
-                if (gestureValues.length() == 0) {
-                    static const QMetaEnum gearSensorEventEnum = GearBase::staticMetaObject.enumerator(GearBase::staticMetaObject.indexOfEnumerator("GearSensorEvent"));
-                    for (int enumKey = 0; enumKey < gearSensorEventEnum.keyCount(); ++enumKey) {
-                        GearBase::GearSensorEvent eventKey = static_cast<GearBase::GearSensorEvent>(gearSensorEventEnum.value(enumKey));
-                        gestureValues << eventKey;
-                    }
-                }
-                value.setValue(gestureValues);
-                break; }
-            case GestureEventTitles: {
-                static QStringList gestureTitles;
-                if (gestureTitles.length() == 0) {
-                    static const QMetaEnum gearSensorEventEnum = GearBase::staticMetaObject.enumerator(GearBase::staticMetaObject.indexOfEnumerator("GearSensorEvent"));
-                    static const QHash<GearBase::GearSensorEvent, QString> gearSensorEventTranslations{
-                        {GearBase::GearSensorEvent::TiltLeftEvent, i18nc("Name for an event where the gear has been detected as having been tilted to the left", "Tilt Left")},
-                        {GearBase::GearSensorEvent::TiltRightEvent, i18nc("Name for an event where the gear has been detected as having been tilted to the right", "Tilt Right")},
-                        {GearBase::GearSensorEvent::TiltForwardEvent, i18nc("Name for an event where the gear has been detected as having been tilted forward", "Tilt Forward")},
-                        {GearBase::GearSensorEvent::TiltBackwardEvent, i18nc("Name for an event where the gear has been detected as having been tilted backward", "Tilt Backward")},
-                        {GearBase::GearSensorEvent::TiltNeutralEvent, i18nc("Name for an event where the gear has been returned to an upright position from having been tilted", "Return to Upright")},
-                        {GearBase::GearSensorEvent::SoundLeftLoudEvent, i18nc("Name for an event where a large amount of sound has been detected on the left hand side of the gear", "Loud Sound on the Left")},
-                        {GearBase::GearSensorEvent::SoundLeftQuietEvent, i18nc("Name for an event where a small, but detectable amount of sound has been detected on the left hand side of the gear", "Quiet Sound on the Left")},
-                        {GearBase::GearSensorEvent::SoundNeutralEvent, i18nc("Name for an event where the sound levels have been detected as returning to ambient after detecting a sound on one or the other side", "Ambient Sound Levels")},
-                        {GearBase::GearSensorEvent::SoundRightQuietEvent, i18nc("Name for an event where a small, but detectable amount of sound has been detected on the right hand side of the gear", "Quiet Sound on the Right")},
-                        {GearBase::GearSensorEvent::SoundRightLoudEvent, i18nc("Name for an event where a large amount of sound has been detected on the right hand side of the gear", "Loud Sound on the Right")},
-                    };
-                    for (int enumKey = 0; enumKey < gearSensorEventEnum.keyCount(); ++enumKey) {
-                        GearBase::GearSensorEvent eventKey = static_cast<GearBase::GearSensorEvent>(gearSensorEventEnum.value(enumKey));
-                        if (gearSensorEventTranslations.contains(eventKey)) {
-                            gestureTitles << gearSensorEventTranslations[eventKey];
-                        } else {
-                            gestureTitles << QString::fromUtf8(gearSensorEventEnum.key(enumKey));
-                        }
-                    }
-                }
-                value = gestureTitles;
-                break; }
-            case GestureEventCommands: {
+            value = tiltEnabled;
+            break;
+        }
+        case KnownFirmwareMessage:
+            value = device->knownFirmwareMessage();
+            break;
+        case GestureEventValues: {
+            static QVariantList gestureValues;
+            if (gestureValues.length() == 0) {
                 static const QMetaEnum gearSensorEventEnum = GearBase::staticMetaObject.enumerator(GearBase::staticMetaObject.indexOfEnumerator("GearSensorEvent"));
-                QStringList devices;
                 for (int enumKey = 0; enumKey < gearSensorEventEnum.keyCount(); ++enumKey) {
                     GearBase::GearSensorEvent eventKey = static_cast<GearBase::GearSensorEvent>(gearSensorEventEnum.value(enumKey));
-                    devices << device->gearSensorCommand(eventKey);
+                    gestureValues << eventKey;
                 }
-                value = devices;
-                break; }
-            case GestureEventDevices: {
+            }
+            value.setValue(gestureValues);
+            break; }
+        case GestureEventTitles: {
+            static QStringList gestureTitles;
+            if (gestureTitles.length() == 0) {
                 static const QMetaEnum gearSensorEventEnum = GearBase::staticMetaObject.enumerator(GearBase::staticMetaObject.indexOfEnumerator("GearSensorEvent"));
-                QStringList devices;
+                static const QHash<GearBase::GearSensorEvent, QString> gearSensorEventTranslations{
+                    {GearBase::GearSensorEvent::TiltLeftEvent, i18nc("Name for an event where the gear has been detected as having been tilted to the left", "Tilt Left")},
+                    {GearBase::GearSensorEvent::TiltRightEvent, i18nc("Name for an event where the gear has been detected as having been tilted to the right", "Tilt Right")},
+                    {GearBase::GearSensorEvent::TiltForwardEvent, i18nc("Name for an event where the gear has been detected as having been tilted forward", "Tilt Forward")},
+                    {GearBase::GearSensorEvent::TiltBackwardEvent, i18nc("Name for an event where the gear has been detected as having been tilted backward", "Tilt Backward")},
+                    {GearBase::GearSensorEvent::TiltNeutralEvent, i18nc("Name for an event where the gear has been returned to an upright position from having been tilted", "Return to Upright")},
+                    {GearBase::GearSensorEvent::SoundLeftLoudEvent, i18nc("Name for an event where a large amount of sound has been detected on the left hand side of the gear", "Loud Sound on the Left")},
+                    {GearBase::GearSensorEvent::SoundLeftQuietEvent, i18nc("Name for an event where a small, but detectable amount of sound has been detected on the left hand side of the gear", "Quiet Sound on the Left")},
+                    {GearBase::GearSensorEvent::SoundNeutralEvent, i18nc("Name for an event where the sound levels have been detected as returning to ambient after detecting a sound on one or the other side", "Ambient Sound Levels")},
+                    {GearBase::GearSensorEvent::SoundRightQuietEvent, i18nc("Name for an event where a small, but detectable amount of sound has been detected on the right hand side of the gear", "Quiet Sound on the Right")},
+                    {GearBase::GearSensorEvent::SoundRightLoudEvent, i18nc("Name for an event where a large amount of sound has been detected on the right hand side of the gear", "Loud Sound on the Right")},
+                };
                 for (int enumKey = 0; enumKey < gearSensorEventEnum.keyCount(); ++enumKey) {
                     GearBase::GearSensorEvent eventKey = static_cast<GearBase::GearSensorEvent>(gearSensorEventEnum.value(enumKey));
-                    devices << device->gearSensorTargetDevices(eventKey);
-                }
-                value = devices;
-                break; }
-            case SupportedTiltEvents:
-                value = device->supportedTiltEvents();
-                break;
-            case SupportedSoundEvents:
-                value = device->supportedSoundEvents();
-                break;
-            case Color:
-                value = device->color();
-                break;
-            case DeviceType:
-                if (device->inherits("GearDigitail")) {
-                    value = QLatin1String{"DiGITAIL"};
-                } else if (device->inherits("GearMitail")) {
-                    value = QLatin1String{"MiTail"};
-                } else if (device->inherits("GearEars")) {
-                    value = QLatin1String{"EarGear"};
-                } else if (device->inherits("GearFlutterWings")) {
-                    value = QLatin1String{"FlutterWings"};
-                } else if (device->inherits("GearMitailMini")) {
-                    value = QLatin1String{"MiTail Mini"};
-                } else if (device->inherits("GearFake")) {
-                    value = QLatin1String{"Fake Tail"};
-                } else {
-                    value = QLatin1String{"Unknown"};
-                }
-                break;
-            case DeviceIcon:
-                if (device->inherits("GearDigitail")) {
-                    value = QLatin1String{":/images/tail.svg"};
-                } else if (device->inherits("GearMitail")) {
-                    value = QLatin1String{":/images/taildevice.svg"};
-                } else if (device->inherits("GearEars")) {
-                    value = QLatin1String{":/images/eargear.svg"};
-                } else if (device->inherits("GearFlutterWings")) {
-                    value = QLatin1String{":/images/flutter.svg"};
-                } else if (device->inherits("GearMitailMini")) {
-                    value = QLatin1String{":/images/mitailmini.svg"};
-                } else if (device->inherits("GearFake")) {
-                    value = QLatin1String{":/images/taildevice.svg"};
-                } else {
-                    value = QLatin1String{":/images/logo.svg"};
+                    if (gearSensorEventTranslations.contains(eventKey)) {
+                        gestureTitles << gearSensorEventTranslations[eventKey];
+                    } else {
+                        gestureTitles << QString::fromUtf8(gearSensorEventEnum.key(enumKey));
+                    }
                 }
-                break;
-            case IsConnecting:
-                return device->isConnecting();
-            case AutoConnect:
-                return device->autoConnect();
-            case IsKnown:
-                return device->isKnown();
-            default:
-                break;
-        }
-    };
+            }
+            value = gestureTitles;
+            break; }
+        case GestureEventCommands: {
+            static const QMetaEnum gearSensorEventEnum = GearBase::staticMetaObject.enumerator(GearBase::staticMetaObject.indexOfEnumerator("GearSensorEvent"));
+            QStringList devices;
+            for (int enumKey = 0; enumKey < gearSensorEventEnum.keyCount(); ++enumKey) {
+                GearBase::GearSensorEvent eventKey = static_cast<GearBase::GearSensorEvent>(gearSensorEventEnum.value(enumKey));
+                devices << device->gearSensorCommand(eventKey);
+            }
+            value = devices;
+            break; }
+        case GestureEventDevices: {
+            static const QMetaEnum gearSensorEventEnum = GearBase::staticMetaObject.enumerator(GearBase::staticMetaObject.indexOfEnumerator("GearSensorEvent"));
+            QStringList devices;
+            for (int enumKey = 0; enumKey < gearSensorEventEnum.keyCount(); ++enumKey) {
+                GearBase::GearSensorEvent eventKey = static_cast<GearBase::GearSensorEvent>(gearSensorEventEnum.value(enumKey));
+                devices << device->gearSensorTargetDevices(eventKey);
+            }
+            value = devices;
+            break; }
+        case SupportedTiltEvents:
+            value = device->supportedTiltEvents();
+            break;
+        case SupportedSoundEvents:
+            value = device->supportedSoundEvents();
+            break;
+        case Color:
+            value = device->color();
+            break;
+        case DeviceType:
+            if (device->inherits("GearDigitail")) {
+                value = QLatin1String{"DiGITAIL"};
+            } else if (device->inherits("GearMitail")) {
+                value = QLatin1String{"MiTail"};
+            } else if (device->inherits("GearEars")) {
+                value = QLatin1String{"EarGear"};
+            } else if (device->inherits("GearFlutterWings")) {
+                value = QLatin1String{"FlutterWings"};
+            } else if (device->inherits("GearMitailMini")) {
+                value = QLatin1String{"MiTail Mini"};
+            } else if (device->inherits("GearFake")) {
+                value = QLatin1String{"Fake Tail"};
+            } else {
+                value = QLatin1String{"Unknown"};
+            }
+            break;
+        case DeviceIcon:
+            if (device->inherits("GearDigitail")) {
+                value = QLatin1String{":/images/tail.svg"};
+            } else if (device->inherits("GearMitail")) {
+                value = QLatin1String{":/images/taildevice.svg"};
+            } else if (device->inherits("GearEars")) {
+                value = QLatin1String{":/images/eargear.svg"};
+            } else if (device->inherits("GearFlutterWings")) {
+                value = QLatin1String{":/images/flutter.svg"};
+            } else if (device->inherits("GearMitailMini")) {
+                value = QLatin1String{":/images/mitailmini.svg"};
+            } else if (device->inherits("GearFake")) {
+                value = QLatin1String{":/images/taildevice.svg"};
+            } else {
+                value = QLatin1String{":/images/logo.svg"};
+            }
+            break;
+        case IsConnecting:
+            return device->isConnecting();
+        case AutoConnect:
+            return device->autoConnect();
+        case IsKnown:
+            return device->isKnown();
+        case TimeToReady:
+            return device->timeToReady();
+        case SignalStrength:
+            return device->signalStrength();
+        default:
+            break;
+    }
     return value;
 }
 
@@ -390,8 +724,41 @@ bool DeviceModel::isConnected() const
     return false;
 }
 
+// It feels a little dirty to do it this way...
+static const QSet<QString> acceptedDeviceNames{
+    QLatin1String{"EarGear"},
+    QLatin1String{"EG2"},
+    QLatin1String{"mitail"},
+    QLatin1String{"minitail"},
+    QLatin1String{"flutter"},
+    QLatin1String{"(!)Tail1"},
+    QLatin1String{"FAKE"}
+};
+
 void DeviceModel::addDevice(const QBluetoothDeviceInfo& deviceInfo)
 {
+    const quint64 address = deviceInfo.address().toUInt64();
+    GearBase* knownDevice = d->devicesByAddress.value(address);
+    if (knownDevice) {
+        knownDevice->updateDiscoveryInfo(deviceInfo);
+        return;
+    }
+    if (d->rejectedAddresses.contains(address)) {
+        return;
+    }
+    if (deviceInfo.name().isEmpty()) {
+        // Some stacks report the device before they've seen its name, so don't hold that against it
+        return;
+    }
+    if (!acceptedDeviceNames.contains(deviceInfo.name())) {
+        static const QBluetoothUuid gearServiceUuid{QLatin1String{"3af2108b-d066-42da-a7d4-55648fa0a9b6"}};
+        if (deviceInfo.serviceUuids().contains(gearServiceUuid)) {
+            qDebug() << "Found an unsupported device which looks like gear" << deviceInfo.name();
+        }
+        d->rejectedAddresses.insert(address);
+        return;
+    }
+
     GearBase* newDevice{nullptr};
     if (deviceInfo.name() == QLatin1String{"(!)Tail1"}) {
         newDevice = new GearDigitail(deviceInfo, this);
@@ -407,31 +774,21 @@ void DeviceModel::addDevice(const QBluetoothDeviceInfo& deviceInfo)
         newDevice = new GearMitailMini(deviceInfo, this);
     } else {
         qDebug() << "Found an unsupported device" << deviceInfo.name();
+        d->rejectedAddresses.insert(address);
     }
     if (newDevice) {
+        newDevice->updateDiscoveryInfo(deviceInfo);
         addDevice(newDevice);
     }
 }
 
 void DeviceModel::addDevice(GearBase* newDevice)
 {
-    // It feels a little dirty to do it this way...
-    static const QStringList acceptedDeviceNames{
-        QLatin1String{"EarGear"},
-        QLatin1String{"EG2"},
-        QLatin1String{"mitail"},
-        QLatin1String{"minitail"},
-        QLatin1String{"flutter"},
-        QLatin1String{"(!)Tail1"},
-        QLatin1String{"FAKE"}
-    };
     if(acceptedDeviceNames.contains(newDevice->deviceInfo.name())) {
-        for(const GearBase* device : d->devices) {
-            if(device->deviceID() == newDevice->deviceID()) {
-                // Don't add the same device twice. Thanks bt discovery. Thiscovery.
-                newDevice->deleteLater();
-                return;
-            }
+        if(d->devicesByAddress.contains(newDevice->deviceInfo.address().toUInt64())) {
+            // Don't add the same device twice. Thanks bt discovery. Thiscovery.
+            newDevice->deleteLater();
+            return;
         }
 
         static QList<QColor> colors;
@@ -456,151 +813,56 @@ void DeviceModel::addDevice(GearBase* newDevice)
         }
         newDevice->setColor(colors[currentColor]);
 
-        // Device type specifics
-        GearEars* ears = qobject_cast<GearEars*>(newDevice);
-        if (ears) {
-            connect(ears, &GearEars::listenModeChanged, this, [this, newDevice](){
-                d->notifyDeviceDataChanged(newDevice, ListeningState);
-            });
-            connect(ears, &GearEars::micsSwappedChanged, this, [this, newDevice](){
-                d->notifyDeviceDataChanged(newDevice, MicsSwapped);
-            });
-            connect(ears, &GearEars::hasTiltChanged, this, [this, newDevice](){
-                d->notifyDeviceDataChanged(newDevice, HasTilt);
-            });
-            connect(ears, &GearEars::canBalanceListeningChanged, this, [this, newDevice](){
-                d->notifyDeviceDataChanged(newDevice, CanBalanceListening);
-            });
-            connect(ears, &GearEars::tiltEnabledChanged, this, [this, newDevice](){
-                d->notifyDeviceDataChanged(newDevice, TiltEnabled);
-            });
+        // A device may be coming back into the model (like the fake device does), and nothing told it about
+        // changes while it was out, so start the snapshot over rather than trust anything in there
+        newDevice->modelSnapshot()->validRoles = 0;
+        // The type specific details never change (and so are never invalidated), so work those out once and for all
+        for (int role : {DeviceType, DeviceIcon, HasListening}) {
+            Private::snapshotData(newDevice, role);
         }
 
         // General stuff
         connect(newDevice, &GearBase::deviceMessage, this, &DeviceModel::deviceMessage);
         connect(newDevice, &GearBase::deviceBlockingMessage, this, &DeviceModel::deviceBlockingMessage);
-        connect(newDevice, &GearBase::isConnectedChanged, this, [this, newDevice](bool isConnected){
-            if (isConnected) {
-                Q_EMIT deviceConnected(newDevice);
-            } else {
-                Q_EMIT deviceDisconnected(newDevice);
+        connect(newDevice, &GearBase::isConnectedChanged, this, &DeviceModel::deviceIsConnectedChanged);
+        connect(newDevice, &QObject::destroyed, this, &DeviceModel::deviceDestroyed);
+        // Check once the gear has settled, as connecting is allowed to briefly pass through not-connecting while tearing down an old controller
+        connect(newDevice, &GearBase::isConnectingChanged, this, [this, device = QPointer<GearBase>(newDevice)](){
+            if (device && !device->isConnecting()) {
+                d->releaseConnectionSlot(device);
             }
-            d->notifyDeviceDataChanged(newDevice, IsConnected);
-            Q_EMIT isConnectedChanged(this->isConnected());
-        });
-        connect(newDevice, &GearBase::autoConnectChanged, this, [this, newDevice](){
-            d->notifyDeviceDataChanged(newDevice, AutoConnect);
-        });
-        connect(newDevice, &GearBase::isKnownChanged, this, [this, newDevice](){
-            d->notifyDeviceDataChanged(newDevice, IsKnown);
-        });
-        connect(newDevice, &GearBase::isConnectingChanged, this, [this, newDevice](){
-            d->notifyDeviceDataChanged(newDevice, IsConnecting);
-        });
-        connect(newDevice, &GearBase::progressDescriptionChanged, this, [this, newDevice](){
-            d->notifyDeviceDataChanged(newDevice, ProgressDescription);
-        });
-        connect(newDevice, &GearBase::deviceProgressChanged, this, [this, newDevice](){
-            d->notifyDeviceDataChanged(newDevice, OperationInProgress);
-            d->notifyDeviceDataChanged(newDevice, DeviceProgress);
-        });
-        connect(newDevice, &GearBase::supportsOTAChanged, this, [this, newDevice](){
-            d->notifyDeviceDataChanged(newDevice, SupportsOTA);
-        });
-        connect(newDevice, &GearBase::hasAvailableOTAChanged, this, [this, newDevice](){
-            d->notifyDeviceDataChanged(newDevice, HasAvailableOTA);
-            d->notifyDeviceDataChanged(newDevice, OTAVersion);
-        });
-        connect(newDevice, &GearBase::hasOTADataChanged, this, [this, newDevice](){
-            d->notifyDeviceDataChanged(newDevice, HasOTAData);
-        });
-        connect(newDevice, &GearBase::batteryLevelChanged, this, [this, newDevice](){
-            d->notifyDeviceDataChanged(newDevice, BatteryLevel);
-        });
-        connect(newDevice, &GearBase::enabledCommandsFilesChanged, this, [this, newDevice](){
-            d->notifyDeviceDataChanged(newDevice, EnabledCommandsFiles);
-        });
-        connect(newDevice, &GearBase::currentCallChanged, this, [this, newDevice](){
-            d->notifyDeviceDataChanged(newDevice, CurrentCall);
-        });
-        connect(newDevice, &GearBase::activeCommandTitlesChanged, this, [this, newDevice](){
-            d->notifyDeviceDataChanged(newDevice, ActiveCommandTitles);
-        });
-        connect(newDevice, &GearBase::versionChanged, this, [this, newDevice](){
-            d->notifyDeviceDataChanged(newDevice, DeviceVersion);
-        });
-        connect(newDevice, &GearBase::nameChanged, this, [this, newDevice](){
-            d->notifyDeviceDataChanged(newDevice, Name);
-        });
-        connect(newDevice, &GearBase::checkedChanged, this, [this, newDevice](){
-            d->notifyDeviceDataChanged(newDevice, Checked);
-        });
-        connect(newDevice, &GearBase::hasLightsChanged, this, [this, newDevice](){
-            d->notifyDeviceDataChanged(newDevice, HasLights);
-        });
-        connect(newDevice, &GearBase::hasShutdownChanged, this, [this, newDevice](){
-            d->notifyDeviceDataChanged(newDevice, HasShutdown);
-        });
-        connect(newDevice, &GearBase::hasNoPhoneModeChanged, this, [this, newDevice](){
-            d->notifyDeviceDataChanged(newDevice, HasNoPhoneMode);
-        });
-        connect(newDevice, &GearBase::noPhoneModeGroupsChanged, this, [this, newDevice](){
-            d->notifyDeviceDataChanged(newDevice, NoPhoneModeGroups);
-        });
-        connect(newDevice, &GearBase::chargingStateChanged, this, [this, newDevice](){
-            d->notifyDeviceDataChanged(newDevice, ChargingState);
-        });
-        connect(newDevice, &GearBase::batteryLevelPercentChanged, this, [this, newDevice](){
-            d->notifyDeviceDataChanged(newDevice, BatteryLevelPercent);
-        });
-        connect(newDevice, &GearBase::knownFirmwareMessageChanged, this, [this, newDevice](){
-            d->notifyDeviceDataChanged(newDevice, KnownFirmwareMessage);
-        });
-        connect(newDevice, &GearBase::gearSensorCommandDetailsChanged, this, [this, newDevice](){
-            d->notifyDeviceDataChanged(newDevice, GestureEventValues);
-            d->notifyDeviceDataChanged(newDevice, GestureEventTitles);
-            d->notifyDeviceDataChanged(newDevice, GestureEventCommands);
-            d->notifyDeviceDataChanged(newDevice, GestureEventDevices);
-        });
-        connect(newDevice, &QObject::destroyed, this, [this, newDevice](){
-            int index = d->devices.indexOf(newDevice);
-            if(index > -1) {
-                beginRemoveRows(QModelIndex(), index, index);
-                Q_EMIT deviceRemoved(newDevice);
-                d->devices.removeAll(newDevice);
-                endRemoveRows();
-            }
-        });
-        connect(newDevice, &GearBase::supportedTiltEventsChanged, this, [this, newDevice](){
-            d->notifyDeviceDataChanged(newDevice, SupportedTiltEvents);
-        });
-        connect(newDevice, &GearBase::supportedSoundEventsChanged, this, [this, newDevice](){
-            d->notifyDeviceDataChanged(newDevice, SupportedSoundEvents);
-        });
-        connect(newDevice, &GearBase::colorChanged, this, [this, newDevice](){
-            d->notifyDeviceDataChanged(newDevice, Color);
-        });
+        }, Qt::QueuedConnection);
+        // Everything else just means some roles changed, which the property table tells us about
+        static const int deviceDataChangedIndex = staticMetaObject.indexOfSlot("deviceDataChanged()");
+        const QHash<int, QList<int>>& signalRoles = d->signalRoles(newDevice->metaObject());
+        for (auto it = signalRoles.constBegin(); it != signalRoles.constEnd(); ++it) {
+            QMetaObject::connect(newDevice, it.key(), this, deviceDataChangedIndex);
+        }
 
         beginInsertRows(QModelIndex(), 0, 0);
         d->devices.insert(0, newDevice);
+        d->indexDevice(newDevice);
         Q_EMIT deviceAdded(newDevice);
         Q_EMIT countChanged();
         endInsertRows();
 
         if (newDevice->autoConnect()) {
-            newDevice->connectDevice();
+            d->queueConnection(newDevice);
         }
     }
 }
 
 void DeviceModel::removeDevice(GearBase* device)
 {
-    int idx = d->devices.indexOf(device);
+    int idx = d->deviceIndices.value(device).row;
     if (idx > -1) {
         beginRemoveRows(QModelIndex(), idx, idx);
         Q_EMIT deviceRemoved(device);
+        d->forgetConnection(device);
+        d->unindexDevice(device);
         device->disconnect(this);
         d->devices.removeAt(idx);
+        d->updateRows();
         Q_EMIT countChanged();
         endRemoveRows();
     }
@@ -609,6 +871,55 @@ void DeviceModel::removeDevice(GearBase* device)
     }
 }
 
+void DeviceModel::deviceDataChanged()
+{
+    // Only gear is ever connected to this slot, so there's no need to go through qobject_cast
+    GearBase* device = static_cast<GearBase*>(sender());
+    const QList<int> roles = d->signalRoles(device->metaObject()).value(senderSignalIndex());
+    for (int role : roles) {
+        d->notifyDeviceDataChanged(device, role);
+    }
+}
+
+void DeviceModel::deviceIsConnectedChanged(bool isConnected)
+{
+    GearBase* device = static_cast<GearBase*>(sender());
+    if (isConnected) {
+        Q_EMIT deviceConnected(device);
+    } else {
+        Q_EMIT deviceDisconnected(device);
+        // Anybody holding on to sets with this device in them has now been told, so the bit can go to someone else
+        d->releaseSlot(device);
+    }
+    d->notifyDeviceDataChanged(device, IsConnected);
+    Q_EMIT isConnectedChanged(this->isConnected());
+}
+
+void DeviceModel::deviceDestroyed(QObject* object)
+{
+    // The device is already gone by now, so only ever use this as a key
+    GearBase* device = static_cast<GearBase*>(object);
+    d->forgetConnection(device);
+    int index = d->deviceIndices.value(device).row;
+    if(index > -1) {
+        beginRemoveRows(QModelIndex(), index, index);
+        Q_EMIT deviceRemoved(device);
+        d->unindexDevice(device);
+        d->devices.removeAt(index);
+        d->updateRows();
+        endRemoveRows();
+    }
+}
+
+void DeviceModel::connectToAllKnownDevices()
+{
+    for (GearBase* device : std::as_const(d->devices)) {
+        if (device->isKnown() && device->autoConnect() && !device->isConnected() && !device->isConnecting()) {
+            d->queueConnection(device);
+        }
+    }
+}
+
 int DeviceModel::count()
 {
     return d->devices.count();
@@ -616,12 +927,7 @@ int DeviceModel::count()
 
 GearBase* DeviceModel::getDevice(const QString& deviceID) const
 {
-    for(GearBase* device : d->devices) {
-        if(device->deviceID() == deviceID) {
-            return device;
-        }
-    }
-    return nullptr;
+    return d->devicesByID.value(deviceID);
 }
 
 GearBase * DeviceModel::getDeviceById ( int index ) const
@@ -640,11 +946,78 @@ QString DeviceModel::getDeviceID(int deviceIndex) const
     return QLatin1String();
 }
 
+DeviceModel::DeviceSet DeviceModel::deviceSet(GearBase* device) const
+{
+    const int slot = d->acquireSlot(device);
+    return slot > -1 ? (DeviceSet{1} << slot) : DeviceSet{0};
+}
+
+DeviceModel::DeviceSet DeviceModel::deviceSet(const QStringList& deviceIDs) const
+{
+    // If there's no devices requested, that means everybody
+    if (deviceIDs.isEmpty()) {
+        return AllDevices;
+    }
+    DeviceSet set{0};
+    for (const QString& deviceID : deviceIDs) {
+        set |= deviceSet(d->devicesByID.value(deviceID));
+    }
+    return set;
+}
+
+QList<GearBase*> DeviceModel::devices(DeviceSet deviceSet) const
+{
+    QList<GearBase*> result;
+    if (deviceSet == AllDevices) {
+        result = d->devices;
+    } else {
+        while (deviceSet) {
+            GearBase* device = d->deviceSlots[qCountTrailingZeroBits(deviceSet)];
+            if (device) {
+                result << device;
+            }
+            // Clear the lowest set bit, and move on to the next one
+            deviceSet &= deviceSet - 1;
+        }
+    }
+    return result;
+}
+
 void DeviceModel::sendMessage(const QString& message, const QStringList& deviceIDs)
 {
-    for (GearBase* device : d->devices) {
-        // If there's no devices requested, send to everybody
-        if (deviceIDs.count() == 0 || deviceIDs.contains(device->deviceID())) {
+    sendMessage(message, deviceSet(deviceIDs));
+}
+
+void DeviceModel::sendMessage(const QString& message, DeviceSet deviceSet)
+{
+    CommandTracer::instance()->instant("DeviceModel::sendMessage", message);
+    const QList<GearBase*> targets = devices(deviceSet);
+    if (targets.count() < 2 || !d->appSettings || !d->appSettings->synchronizedStart()) {
+        for (GearBase* device : targets) {
+            device->sendMessage(message);
+        }
+        return;
+    }
+    // Hold back the writes to the quicker gear, so that the message arrives everywhere at roughly the same time
+    int maxLatency{0};
+    for (GearBase* device : targets) {
+        if (device->isConnected()) {
+            maxLatency = qMax(maxLatency, device->estimatedWriteLatency());
+        }
+    }
+    for (GearBase* device : targets) {
+        // Something has gone wrong with the measurement if we'd need to wait for more than that, so don't make the user wait on it
+        static const int maxSynchronizationDelay{500};
+        const int delay = device->isConnected() ? qMin(maxSynchronizationDelay, maxLatency - device->estimatedWriteLatency()) : 0;
+        if (delay > 0) {
+            QPointer<GearBase> guard{device};
+            QTimer::singleShot(delay, Qt::PreciseTimer, this, [guard, message](){
+                if (guard) {
+                    CommandTracer::instance()->instant("DeviceModel::synchronizedSend", message, guard->deviceID());
+                    guard->sendMessage(message);
+                }
+            });
+        } else {
             device->sendMessage(message);
         }
     }
@@ -80,9 +80,26 @@ public:
         IsConnecting,            // 295 - Whether the device we are currently attempting to establish a connection to the device
         AutoConnect,             // 296 - Whether the device should be connected to automatically
         IsKnown,                 // 297 - Whether the device is known (we recognise a device as "known" if we have ever connected to it
+        TimeToReady,             // 298 - integer number of milliseconds from starting to connect until the device was ready for commands (-1 if not ready)
+        SignalStrength,          // 299 - integer signal strength (in dBm) of the device when it was last seen during discovery
     };
     Q_ENUM(Roles)
 
+    /**
+     * A compact handle for a set of devices, with one bit per connected device in
+     * the model. Use deviceSet() to get one, and pass it around instead of lists of
+     * device IDs when the set of devices is needed repeatedly. The bits are only
+     * valid while the devices remain connected (deviceDisconnected or deviceRemoved
+     * is emitted before a device's bit is handed to another device, so clear it
+     * from any sets you hold on to then).
+     */
+    typedef quint64 DeviceSet;
+    /**
+     * The set which always means all devices in the model, including any added later
+     */
+    static constexpr DeviceSet AllDevices{~DeviceSet{0}};
+    static constexpr int MaxDeviceSetSlots{64};
+
     AppSettings* appSettings() const;
     void setAppSettings(AppSettings* appSettings);
 
@@ -102,6 +119,11 @@ public:
      * The new device is added at the start of the unsorted model
      * The model takes ownership of the device, and deletion should not
      * be done manually.
+     *
+     * When passed discovery information, devices which are not gear we support,
+     * and devices we already know, are weeded out before any gear object is
+     * constructed. For the ones we know, only the signal strength and time last
+     * seen are updated, so this is safe to call for every discovery report.
      * @param newDevice The new device to show in the model
      */
     Q_SLOT void addDevice(const QBluetoothDeviceInfo& deviceInfo);
@@ -114,6 +136,22 @@ public:
      */
     void removeDevice(GearBase* device);
 
+    /**
+     * Start connecting to every known piece of gear which is set to connect
+     * automatically, and which is not already connected. The connections are
+     * attempted in parallel, but never more at the same time than
+     * AppSettings::maxConcurrentConnections allows.
+     * @see connectionProgress(int, int)
+     */
+    void connectToAllKnownDevices();
+    /**
+     * Emitted as connection attempts started through the connection queue
+     * complete (whether successfully or not)
+     * @param completed The number of attempts which have completed
+     * @param total The total number of attempts which have been queued since the queue was last empty
+     */
+    Q_SIGNAL void connectionProgress(int completed, int total);
+
     int count();
     Q_SIGNAL void countChanged();
 
@@ -130,6 +168,35 @@ public:
      * @param deviceIDs A list of devices to send the message to (empty means all)
      */
     Q_SLOT void sendMessage(const QString& message, const QStringList& deviceIDs = QStringList());
+    /**
+     * Send a message to all the devices in the given set. If
+     * AppSettings::synchronizedStart is enabled and the message goes to more
+     * than one device, the writes to the quicker devices are delayed by the
+     * difference in their estimated write latency, so the message arrives
+     * everywhere at roughly the same time.
+     * @param message The message to be sent out
+     * @param deviceSet The set of devices to send the message to
+     */
+    void sendMessage(const QString& message, DeviceSet deviceSet);
+
+    /**
+     * The set containing only the given device
+     * @param device A device in the model
+     * @return A set with the single device, or an empty set if the device is not in the model or not connected
+     */
+    DeviceSet deviceSet(GearBase* device) const;
+    /**
+     * The set of devices with the given IDs
+     * @param deviceIDs A list of device IDs (an empty list means all devices)
+     * @return A set containing the connected devices in the model which match the IDs
+     */
+    DeviceSet deviceSet(const QStringList& deviceIDs) const;
+    /**
+     * The devices in the given set
+     * @param deviceSet A set of devices
+     * @return A list of the devices in the set which are still in the model
+     */
+    QList<GearBase*> devices(DeviceSet deviceSet) const;
     Q_SIGNAL void deviceMessage(const QString& deviceID, const QString& message);
     Q_SIGNAL void deviceBlockingMessage(const QString& title, const QString& message);
 
@@ -140,6 +207,11 @@ public:
 private:
     class Private;
     Private* d;
+
+    // All the simple role changes on devices arrive here, and are looked up by the signal which was emitted
+    Q_SLOT void deviceDataChanged();
+    Q_SLOT void deviceIsConnectedChanged(bool isConnected);
+    Q_SLOT void deviceDestroyed(QObject* object);
 };
 
 #endif//DEVICEMODEL_H
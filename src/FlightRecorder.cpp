@@ -0,0 +1,112 @@
+/*
+ *   Copyright 2026 Dan Leinir Turthra Jensen <admin@leinir.dk>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 3, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Library General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public License
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>
+ */
+
+#include "FlightRecorder.h"
+
+#include <QDateTime>
+#include <QElapsedTimer>
+
+#include <cstring>
+
+class FlightRecorder::Private {
+public:
+    Private() {
+        started = QDateTime::currentDateTime();
+        clock.start();
+    }
+    ~Private() {}
+    // A single BLE packet with the default MTU carries 20 bytes, and our messages rarely go beyond that
+    static constexpr int maxPayloadSize{20};
+    static constexpr int capacity{512};
+    struct Entry {
+        qint64 timestamp; // milliseconds since the recorder was created
+        EventCode code;
+        quint8 storedSize;
+        quint16 payloadSize;
+        char payload[maxPayloadSize];
+    };
+    Entry entries[capacity];
+    int next{0};
+    int count{0};
+    QDateTime started;
+    QElapsedTimer clock;
+
+    static const char* codeName(EventCode code) {
+        switch(code) {
+            case NotificationEvent: return "NOTIFY";
+            case WriteEvent: return "WRITE";
+            case WriteCompletedEvent: return "WRITTEN";
+            case BusyRetryEvent: return "BUSY";
+            case ConnectedEvent: return "CONNECTED";
+            case DisconnectedEvent: return "DISCONNECTED";
+            case ReconnectAttemptEvent: return "RECONNECT";
+        }
+        return "UNKNOWN";
+    }
+};
+
+FlightRecorder::FlightRecorder()
+    : d(new Private)
+{
+}
+
+FlightRecorder::~FlightRecorder()
+{
+    delete d;
+}
+
+void FlightRecorder::record(EventCode code, const QByteArray& payload)
+{
+    Private::Entry& entry = d->entries[d->next];
+    entry.timestamp = d->clock.elapsed();
+    entry.code = code;
+    entry.payloadSize = quint16(qMin<qsizetype>(payload.size(), 0xFFFF));
+    entry.storedSize = quint8(qMin<qsizetype>(payload.size(), Private::maxPayloadSize));
+    if (entry.storedSize > 0) {
+        std::memcpy(entry.payload, payload.constData(), entry.storedSize);
+    }
+    d->next = (d->next + 1) % Private::capacity;
+    d->count = qMin(d->count + 1, int(Private::capacity));
+}
+
+void FlightRecorder::clear()
+{
+    d->next = 0;
+    d->count = 0;
+}
+
+QString FlightRecorder::dump() const
+{
+    QString result;
+    const int first = (d->next - d->count + Private::capacity) % Private::capacity;
+    for (int i = 0; i < d->count; ++i) {
+        const Private::Entry& entry = d->entries[(first + i) % Private::capacity];
+        const QByteArray payload = QByteArray::fromRawData(entry.payload, entry.storedSize);
+        QString text;
+        for (const char character : payload) {
+            text += (character >= 0x20 && character < 0x7f) ? QLatin1Char(character) : QLatin1Char('.');
+        }
+        result += QStringLiteral("%1 %2 [%3] %4 |%5|%6\n")
+            .arg(d->started.addMSecs(entry.timestamp).toString(QStringLiteral("hh:mm:ss.zzz")))
+            .arg(QLatin1String{Private::codeName(entry.code)}, -12)
+            .arg(entry.payloadSize, 3)
+            .arg(QString::fromLatin1(payload.toHex(' ')))
+            .arg(text)
+            .arg(entry.payloadSize > entry.storedSize ? QStringLiteral("...") : QString{});
+    }
+    return result;
+}
@@ -0,0 +1,65 @@
+/*
+ *   Copyright 2026 Dan Leinir Turthra Jensen <admin@leinir.dk>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 3, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Library General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public License
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>
+ */
+
+#ifndef FLIGHTRECORDER_H
+#define FLIGHTRECORDER_H
+
+#include <QByteArray>
+#include <QString>
+
+/**
+ * A record of the most recent traffic to and from a piece of gear, kept in a
+ * fixed size ring buffer of raw payloads, so it costs next to nothing to keep
+ * running all the time. Nothing gets formatted until the recording is dumped,
+ * which makes this a much cheaper way of finding out what happened than
+ * logging every packet as it goes past.
+ */
+class FlightRecorder
+{
+public:
+    enum EventCode : quint8 {
+        NotificationEvent, ///< A notification arrived from the gear
+        WriteEvent, ///< We wrote a message to the gear
+        WriteCompletedEvent, ///< The stack reported the write as done
+        BusyRetryEvent, ///< The gear was busy, and we will have to send the message again
+        ConnectedEvent, ///< The gear was connected
+        DisconnectedEvent, ///< The gear was disconnected
+        ReconnectAttemptEvent, ///< An attempt to reconnect to the gear was made
+    };
+
+    FlightRecorder();
+    ~FlightRecorder();
+
+    /**
+     * Record an event. Only the start of the payload is kept (though the full
+     * length is recorded), which is plenty for the messages we send back and forth.
+     * @param code What happened
+     * @param payload The raw data which went across the link, if any
+     */
+    void record(EventCode code, const QByteArray& payload = QByteArray{});
+    void clear();
+    /**
+     * The recorded events, oldest first, one per line, with the time they
+     * happened, the event and the payload as both hex and text
+     */
+    QString dump() const;
+private:
+    class Private;
+    Private* d;
+};
+
+#endif//FLIGHTRECORDER_H
@@ -17,15 +17,24 @@
 
 #include "GearBase.h"
 
+#include <KLocalizedString>
+
 #include <QCoreApplication>
 #include <QColor>
 #include <QCryptographicHash>
+#include <QElapsedTimer>
 #include <QFile>
+#include <QLowEnergyConnectionParameters>
+#include <QPointer>
 #include <QSettings>
 #include <QTimer>
 
 #include "AppSettings.h"
 #include "CommandPersistence.h"
+#include "CommandTracer.h"
+#include "FlightRecorder.h"
+#include "LinkTelemetry.h"
+#include "ReconnectionPolicy.h"
 
 struct GearSensorEventDetails {
 public:
@@ -38,6 +47,8 @@ public:
     QString command;
 };
 
+Q_LOGGING_CATEGORY(gearTraffic, "crumpet.gear.traffic", QtWarningMsg)
+
 class GearBase::Private {
 public:
     Private(GearBase *q)
@@ -47,8 +58,11 @@ public:
     void load();
     void save();
     void handleGearSensorEvent(const GearSensorEvent &event);
+    void requestConnectionProfile();
+    void completeHandshake();
 
     GearBase *q{nullptr};
+    QString deviceID;
     int batteryLevelPercent{100};
     QColor color;
     bool supportsOTA{false};
@@ -69,6 +83,48 @@ public:
     DeviceModel * parentModel{nullptr};
     QHash<GearBase::GearSensorEvent, GearSensorEventDetails> gearSensorEvents;
 
+    QPointer<QLowEnergyController> lowEnergyController;
+    ConnectionProfile connectionProfile{ActiveConnectionProfile};
+    // How long the link needs to be quiet before we drop to the idle connection profile
+    static const int idleProfileTimeout{60000};
+    QTimer idleProfileTimer;
+
+    QElapsedTimer connectionTimer;
+    QList<HandshakeQuery> pendingHandshakeQueries;
+    // The queries are sent one at a time, so a reply (or the gear's idea of the current call) can't get mixed up with the next query
+    QList<HandshakeQuery> unsentHandshakeQueries;
+    QString awaitedHandshakeQuery;
+    bool handshakeWriteInFlight{false};
+    bool sendingHandshakeQuery{false};
+    void sendNextHandshakeQuery();
+    bool handshakeComplete{false};
+    bool handshakeRetried{false};
+    // How long we wait for the gear to reply to the handshake before trying again (and then giving up)
+    static const int handshakeTimeout{3000};
+    QTimer handshakeTimer;
+    int timeToReady{-1};
+    // The firmware version the gear was running when we last successfully resolved its service layout
+    QString serviceLayoutVersion;
+    // Whether the gear has told us its firmware version on this connection
+    bool versionReported{false};
+
+    ReconnectionPolicy* reconnectionPolicy{nullptr};
+    LinkTelemetry linkTelemetry;
+    FlightRecorder flightRecorder;
+    // Write latency is tracked as an exponentially weighted moving average, with this much weight given to each new sample
+    static constexpr double latencySmoothing{0.2};
+    QElapsedTimer writeTimer;
+    QElapsedTimer trafficTimer;
+    QString writingMessage;
+    QElapsedTimer pingTimer;
+    double writeLatency{-1};
+    double pingLatency{-1};
+    void addLatencySample(double& average, qint64 sample) {
+        average = (average < 0) ? sample : (average + latencySmoothing * (sample - average));
+    }
+    QDateTime lastSeen;
+    ModelSnapshot modelSnapshot;
+
     bool isLoading{false};
 };
 
@@ -77,6 +133,7 @@ GearBase::GearBase(const QBluetoothDeviceInfo& info, DeviceModel * parent)
     , deviceInfo(info)
     , d(new Private(this))
 {
+    d->deviceID = info.address().toString();
     d->name = info.name();
     // Set the various device names to actually match the product name, instead of the bluetooth ID
     if (d->name == QLatin1String{"(!)Tail1"}) {
@@ -104,6 +161,99 @@ GearBase::GearBase(const QBluetoothDeviceInfo& info, DeviceModel * parent)
     connect(this, &GearBase::enabledCommandsFilesChanged, this, [this](){ d->save(); });
     connect(this, &GearBase::nameChanged, this, [this](){ d->save(); });
     connect(this, &GearBase::gearSensorEvent, this, [this](const GearSensorEvent &event){ d->handleGearSensorEvent(event); });
+
+    d->reconnectionPolicy = new ReconnectionPolicy(this);
+    if (parent) {
+        d->reconnectionPolicy->setAppSettings(parent->appSettings());
+    }
+    if (parent && parent->appSettings()) {
+        AppSettings* appSettings = parent->appSettings();
+        commandModel->setLearnDurations(appSettings->learnCommandDurations());
+        connect(appSettings, &AppSettings::learnCommandDurationsChanged, commandModel, &GearCommandModel::setLearnDurations);
+    }
+    connect(d->reconnectionPolicy, &ReconnectionPolicy::attemptRequested, this, [this](){
+        d->linkTelemetry.addReconnect();
+        d->flightRecorder.record(FlightRecorder::ReconnectAttemptEvent);
+    });
+    connect(d->reconnectionPolicy, &ReconnectionPolicy::attemptScheduled, this, [this](int delay, bool slowRetry){
+        if (slowRetry) {
+            if (isConnected()) {
+                // Let go of the controller while we wait, so we don't pretend to be connected in the meantime
+                disconnectDevice();
+            }
+            if (d->reconnectionPolicy->attempts() == d->reconnectionPolicy->maxAttempts()) {
+                qDebug() << name() << deviceID() << "Attempted to reconnect too many times, dropping to slow retries";
+                Q_EMIT deviceMessage(deviceID(), i18nc("Error message shown when automatic reconnection has been attempted too often, and we are now only occasionally attempting to reconnect", "Attempted to reconnect too many times to %1 (%2). We will keep trying every now and then, but please check that it is on, charged, and near enough.", name(), deviceID()));
+            }
+        } else if (d->reconnectionPolicy->attempts() == 0) {
+            Q_EMIT deviceMessage(deviceID(), i18nc("A status message sent when the connection to a device has been lost, and we are attempting to connect again automatically", "Connection lost to %1, attempting to reconnect...", name()));
+        }
+        qDebug() << name() << deviceID() << "Connection lost - attempting to reconnect in" << delay << "ms";
+    });
+
+    d->idleProfileTimer.setSingleShot(true);
+    d->idleProfileTimer.setTimerType(Qt::VeryCoarseTimer);
+    d->idleProfileTimer.setInterval(Private::idleProfileTimeout);
+    connect(&d->idleProfileTimer, &QTimer::timeout, this, [this](){ setConnectionProfile(IdleConnectionProfile); });
+    // Anything going across the wire counts as activity, except during a firmware upload, which holds on to the transfer profile until it's done
+    connect(this, &GearBase::currentCallChanged, this, [this](){
+        if (d->connectionProfile != TransferConnectionProfile) {
+            setConnectionProfile(ActiveConnectionProfile);
+        }
+    });
+    connect(this, &GearBase::deviceProgressChanged, this, [this](){
+        if (d->deviceProgress == -1 && d->connectionProfile == TransferConnectionProfile) {
+            setConnectionProfile(ActiveConnectionProfile);
+        }
+    });
+
+    d->handshakeTimer.setSingleShot(true);
+    d->handshakeTimer.setInterval(Private::handshakeTimeout);
+    connect(&d->handshakeTimer, &QTimer::timeout, this, [this](){
+        if (d->handshakeRetried) {
+            qWarning() << name() << deviceID() << "The gear did not reply to" << d->pendingHandshakeQueries.count() << "of the handshake queries, considering it ready anyway";
+            d->completeHandshake();
+        } else {
+            d->handshakeRetried = true;
+            // Ask again for whatever we were waiting on, or if a write never completed, just move on to the next one
+            if (!d->awaitedHandshakeQuery.isEmpty()) {
+                d->unsentHandshakeQueries.prepend(HandshakeQuery{d->awaitedHandshakeQuery});
+                d->awaitedHandshakeQuery.clear();
+            }
+            d->handshakeWriteInFlight = false;
+            d->sendNextHandshakeQuery();
+            d->handshakeTimer.start();
+        }
+    });
+    connect(this, &GearBase::handshakeCompleted, this, [this](){
+        // Only remember the layout against a version the gear actually reported this time around
+        if (d->versionReported && !version().isEmpty() && d->serviceLayoutVersion != version()) {
+            d->serviceLayoutVersion = version();
+            d->save();
+        }
+    });
+    connect(this, &GearBase::isConnectedChanged, this, [this](bool isConnected){
+        d->flightRecorder.record(isConnected ? FlightRecorder::ConnectedEvent : FlightRecorder::DisconnectedEvent);
+        if (!isConnected) {
+            d->handshakeTimer.stop();
+            d->pendingHandshakeQueries.clear();
+            d->unsentHandshakeQueries.clear();
+            d->awaitedHandshakeQuery.clear();
+            d->handshakeWriteInFlight = false;
+            d->versionReported = false;
+            d->handshakeComplete = false;
+            // A new link may well have entirely different timing
+            d->writeTimer.invalidate();
+            d->pingTimer.invalidate();
+            d->trafficTimer.invalidate();
+            d->writeLatency = -1;
+            d->pingLatency = -1;
+            if (d->timeToReady != -1) {
+                d->timeToReady = -1;
+                Q_EMIT timeToReadyChanged();
+            }
+        }
+    });
 }
 
 GearBase::~GearBase()
@@ -113,6 +263,7 @@ GearBase::~GearBase()
 
 void GearBase::forget()
 {
+    d->reconnectionPolicy->cancel();
     if (isConnected()) {
         disconnectDevice();
     }
@@ -135,6 +286,9 @@ void GearBase::forget()
     settings.beginGroup("DeviceNameList");
     settings.remove(deviceID());
     settings.endGroup();
+    settings.beginGroup("ServiceLayouts");
+    settings.remove(deviceID());
+    settings.endGroup();
     settings.sync();
     deleteLater();
 }
@@ -171,6 +325,9 @@ void GearBase::Private::load()
     settings.beginGroup("DeviceNameList");
     q->setName(settings.value(q->deviceID(), name).toString());
     settings.endGroup();
+    settings.beginGroup("ServiceLayouts");
+    serviceLayoutVersion = settings.value(q->deviceID()).toString();
+    settings.endGroup();
     isLoading = false;
 }
 
@@ -208,6 +365,13 @@ void GearBase::Private::save()
             settings.setValue(q->deviceID(), q->name());
         }
         settings.endGroup();
+        settings.beginGroup("ServiceLayouts");
+        if (serviceLayoutVersion.isEmpty()) {
+            settings.remove(q->deviceID());
+        } else {
+            settings.setValue(q->deviceID(), serviceLayoutVersion);
+        }
+        settings.endGroup();
         settings.sync();
     }
 }
@@ -220,6 +384,287 @@ void GearBase::Private::handleGearSensorEvent(const GearSensorEvent& event)
     }
 }
 
+void GearBase::Private::requestConnectionProfile()
+{
+    if (lowEnergyController) {
+        const QLowEnergyController::ControllerState state = lowEnergyController->state();
+        if (state == QLowEnergyController::ConnectedState || state == QLowEnergyController::DiscoveringState || state == QLowEnergyController::DiscoveredState) {
+            // On Android, these end up mapped to the three connection priorities (minimum intervals below 30ms
+            // are high priority, above 100ms are low power, and anything in between is balanced)
+            QLowEnergyConnectionParameters parameters;
+            switch (connectionProfile) {
+                case TransferConnectionProfile:
+                    parameters.setIntervalRange(7.5, 15);
+                    parameters.setLatency(0);
+                    parameters.setSupervisionTimeout(4000);
+                    break;
+                case IdleConnectionProfile:
+                    parameters.setIntervalRange(150, 300);
+                    parameters.setLatency(4);
+                    parameters.setSupervisionTimeout(6000);
+                    break;
+                case ActiveConnectionProfile:
+                default:
+                    parameters.setIntervalRange(30, 50);
+                    parameters.setLatency(0);
+                    parameters.setSupervisionTimeout(5000);
+                    break;
+            }
+            lowEnergyController->requestConnectionUpdate(parameters);
+        }
+    }
+}
+
+void GearBase::Private::sendNextHandshakeQuery()
+{
+    if (unsentHandshakeQueries.isEmpty()) {
+        return;
+    }
+    const HandshakeQuery query = unsentHandshakeQueries.takeFirst();
+    sendingHandshakeQuery = true;
+    q->sendMessage(query.message);
+    sendingHandshakeQuery = false;
+    if (query.awaitsReply) {
+        awaitedHandshakeQuery = query.message;
+    } else {
+        handshakeWriteInFlight = true;
+    }
+}
+
+void GearBase::Private::completeHandshake()
+{
+    handshakeTimer.stop();
+    pendingHandshakeQueries.clear();
+    handshakeComplete = true;
+    q->reloadCommands();
+    timeToReady = connectionTimer.isValid() ? connectionTimer.elapsed() : 0;
+    qDebug() << q->name() << q->deviceID() << "Ready for commands after" << timeToReady << "milliseconds";
+    Q_EMIT q->timeToReadyChanged();
+    Q_EMIT q->handshakeCompleted();
+}
+
+void GearBase::startHandshake(const QList<HandshakeQuery>& queries)
+{
+    d->handshakeComplete = false;
+    d->handshakeRetried = false;
+    d->pendingHandshakeQueries.clear();
+    for (const HandshakeQuery& query : queries) {
+        if (query.awaitsReply) {
+            d->pendingHandshakeQueries << query;
+        }
+    }
+    d->unsentHandshakeQueries = queries;
+    d->awaitedHandshakeQuery.clear();
+    d->handshakeWriteInFlight = false;
+    d->sendNextHandshakeQuery();
+    if (d->pendingHandshakeQueries.isEmpty()) {
+        d->completeHandshake();
+    } else {
+        d->handshakeTimer.start();
+    }
+}
+
+void GearBase::handshakeReplyReceived(const QString& message)
+{
+    if (message == QLatin1String{"VER"}) {
+        d->versionReported = true;
+        if (!d->serviceLayoutVersion.isEmpty() && d->serviceLayoutVersion != version()) {
+            // The layout we skipped discovering the values for belongs to some other firmware
+            qDebug() << name() << deviceID() << "The gear reports firmware" << version() << "but the service layout we know is for" << d->serviceLayoutVersion << "so forgetting about that";
+            d->serviceLayoutVersion.clear();
+            d->save();
+        }
+    }
+    if (!d->handshakeComplete) {
+        QMutableListIterator<HandshakeQuery> it(d->pendingHandshakeQueries);
+        while (it.hasNext()) {
+            if (it.next().message == message) {
+                it.remove();
+            }
+        }
+        if (message == d->awaitedHandshakeQuery) {
+            d->awaitedHandshakeQuery.clear();
+            d->sendNextHandshakeQuery();
+        }
+        if (d->pendingHandshakeQueries.isEmpty()) {
+            d->completeHandshake();
+        }
+    }
+}
+
+bool GearBase::isSendingHandshakeQuery() const
+{
+    return d->sendingHandshakeQuery;
+}
+
+bool GearBase::isHandshakeComplete() const
+{
+    return d->handshakeComplete;
+}
+
+QLowEnergyService::DiscoveryMode GearBase::serviceDiscoveryMode() const
+{
+    // If there's an operation in progress (such as reconnecting after a firmware update),
+    // the layout may well be about to change, so don't trust what we know
+    if (d->serviceLayoutVersion.isEmpty() || d->deviceProgress > -1) {
+        return QLowEnergyService::FullDiscovery;
+    }
+    return QLowEnergyService::SkipValueDiscovery;
+}
+
+bool GearBase::forgetServiceLayout()
+{
+    if (d->serviceLayoutVersion.isEmpty()) {
+        return false;
+    }
+    qDebug() << name() << deviceID() << "The service layout did not match what we knew for firmware" << d->serviceLayoutVersion << "so forgetting about that";
+    d->serviceLayoutVersion.clear();
+    d->save();
+    return true;
+}
+
+void GearBase::reconnectWithFullDiscovery()
+{
+    QMetaObject::invokeMethod(this, [this](){ connectDevice(); }, Qt::QueuedConnection);
+}
+
+int GearBase::timeToReady() const
+{
+    return d->timeToReady;
+}
+
+const QString& GearBase::deviceID() const
+{
+    return d->deviceID;
+}
+
+GearBase::ModelSnapshot* GearBase::modelSnapshot() const
+{
+    return &d->modelSnapshot;
+}
+
+ReconnectionPolicy* GearBase::reconnectionPolicy() const
+{
+    return d->reconnectionPolicy;
+}
+
+void GearBase::messageWriteStarted(const QString& message)
+{
+    CommandTracer::instance()->instant("writeCharacteristic", message, d->deviceID);
+    d->writingMessage = message;
+    d->flightRecorder.record(FlightRecorder::WriteEvent, message.toUtf8());
+    d->writeTimer.start();
+    if (message == QLatin1String{"PING"}) {
+        d->pingTimer.start();
+    }
+}
+
+void GearBase::messageWriteCompleted()
+{
+    CommandTracer::instance()->instant("characteristicWritten", d->writingMessage, d->deviceID);
+    d->flightRecorder.record(FlightRecorder::WriteCompletedEvent);
+    d->trafficTimer.start();
+    if (d->writeTimer.isValid()) {
+        const qint64 latency = d->writeTimer.elapsed();
+        d->addLatencySample(d->writeLatency, latency);
+        d->linkTelemetry.addWriteLatency(latency);
+        d->writeTimer.invalidate();
+    }
+    if (d->handshakeWriteInFlight) {
+        d->handshakeWriteInFlight = false;
+        d->sendNextHandshakeQuery();
+    }
+}
+
+void GearBase::pongReceived()
+{
+    if (d->pingTimer.isValid()) {
+        const qint64 roundTrip = d->pingTimer.elapsed();
+        d->addLatencySample(d->pingLatency, roundTrip);
+        d->linkTelemetry.addRoundTripTime(roundTrip);
+        d->pingTimer.invalidate();
+    }
+}
+
+int GearBase::estimatedWriteLatency() const
+{
+    if (d->writeLatency >= 0) {
+        return qRound(d->writeLatency);
+    }
+    if (d->pingLatency >= 0) {
+        // The round trip covers the message going both ways, and we only care about the one
+        return qRound(d->pingLatency / 2);
+    }
+    return 0;
+}
+
+void GearBase::notificationReceived(const QByteArray& payload)
+{
+    d->linkTelemetry.addNotification();
+    d->flightRecorder.record(FlightRecorder::NotificationEvent, payload);
+    d->trafficTimer.start();
+}
+
+void GearBase::busyRetryScheduled()
+{
+    d->linkTelemetry.addBusyRetry();
+    d->flightRecorder.record(FlightRecorder::BusyRetryEvent);
+}
+
+LinkTelemetry* GearBase::linkTelemetry() const
+{
+    return &d->linkTelemetry;
+}
+
+FlightRecorder* GearBase::flightRecorder() const
+{
+    return &d->flightRecorder;
+}
+
+qint64 GearBase::msecsSinceLastTraffic() const
+{
+    return d->trafficTimer.isValid() ? d->trafficTimer.elapsed() : -1;
+}
+
+GearBase::ConnectionProfile GearBase::connectionProfile() const
+{
+    return d->connectionProfile;
+}
+
+void GearBase::setConnectionProfile(ConnectionProfile profile)
+{
+    if (profile == IdleConnectionProfile) {
+        d->idleProfileTimer.stop();
+    } else {
+        d->idleProfileTimer.start();
+    }
+    if (d->connectionProfile != profile) {
+        d->connectionProfile = profile;
+        d->requestConnectionProfile();
+        Q_EMIT connectionProfileChanged();
+    }
+}
+
+void GearBase::setLowEnergyController(QLowEnergyController* controller)
+{
+    if (d->lowEnergyController != controller) {
+        if (d->lowEnergyController) {
+            disconnect(d->lowEnergyController, &QLowEnergyController::connectionUpdated, this, nullptr);
+        }
+        d->lowEnergyController = controller;
+        if (controller) {
+            connect(controller, &QLowEnergyController::connectionUpdated, this, [this](const QLowEnergyConnectionParameters& parameters){
+                qDebug() << name() << deviceID() << "Connection parameters updated, interval is now" << parameters.minimumInterval() << "to" << parameters.maximumInterval() << "with a latency of" << parameters.latency();
+            });
+        }
+    }
+    // A fresh link starts out active, both to speed up the discovery and handshake, and because the user is likely about to do something
+    d->connectionProfile = ActiveConnectionProfile;
+    d->requestConnectionProfile();
+    d->idleProfileTimer.start();
+    Q_EMIT connectionProfileChanged();
+}
+
 QColor GearBase::color() const
 {
     return d->color;
@@ -233,6 +678,25 @@ void GearBase::setColor(const QColor& color)
     }
 }
 
+void GearBase::updateDiscoveryInfo(const QBluetoothDeviceInfo& info)
+{
+    d->lastSeen = QDateTime::currentDateTime();
+    if (deviceInfo.rssi() != info.rssi()) {
+        deviceInfo.setRssi(info.rssi());
+        Q_EMIT signalStrengthChanged();
+    }
+}
+
+int GearBase::signalStrength() const
+{
+    return deviceInfo.rssi();
+}
+
+QDateTime GearBase::lastSeen() const
+{
+    return d->lastSeen;
+}
+
 bool GearBase::supportsOTA()
 {
     return d->supportsOTA;
@@ -288,6 +752,10 @@ bool GearBase::isConnecting() const
 
 void GearBase::setIsConnecting(bool isConnecting)
 {
+    if (isConnecting) {
+        // Restarted on every attempt, so time to ready covers only the attempt which succeeded
+        d->connectionTimer.start();
+    }
     if (d->isConnecting != isConnecting) {
         d->isConnecting = isConnecting;
         Q_EMIT isConnectingChanged();
@@ -19,13 +19,27 @@
 #define BTDEVICE_H
 
 #include <QObject>
+#include <QDateTime>
 #include <QBluetoothDeviceInfo>
 #include <QBluetoothAddress>
 #include <QLowEnergyController>
+#include <QLowEnergyService>
+#include <QLoggingCategory>
 
 #include "GearCommandModel.h"
 #include "DeviceModel.h"
 
+class FlightRecorder;
+class LinkTelemetry;
+class ReconnectionPolicy;
+
+/**
+ * The category for the logging of individual messages going back and forth
+ * between us and the gear. This is off by default, as it gets very busy, but
+ * can be enabled using QT_LOGGING_RULES (e.g. "crumpet.gear.traffic.debug=true").
+ * The FlightRecorder keeps track of the same traffic much more cheaply.
+ */
+Q_DECLARE_LOGGING_CATEGORY(gearTraffic)
 
 class GearBase : public QObject
 {
@@ -55,6 +69,8 @@ class GearBase : public QObject
     Q_PROPERTY(QVariantList noPhoneModeGroups READ noPhoneModeGroups NOTIFY noPhoneModeGroupsChanged)
     Q_PROPERTY(int chargingState READ chargingState NOTIFY chargingStateChanged)
     Q_PROPERTY(QString knownFirmwareMessage READ knownFirmwareMessage NOTIFY knownFirmwareMessageChanged)
+    Q_PROPERTY(int timeToReady READ timeToReady NOTIFY timeToReadyChanged)
+    Q_PROPERTY(int signalStrength READ signalStrength NOTIFY signalStrengthChanged)
 public:
     explicit GearBase(const QBluetoothDeviceInfo& info, DeviceModel * parent = nullptr);
     ~GearBase() override;
@@ -73,6 +89,22 @@ public:
     void setColor(const QColor &color);
     Q_SIGNAL void colorChanged();
 
+    /**
+     * Update what we know about the gear from a new discovery report (which
+     * we get repeatedly during a scan, and which carries the signal strength)
+     * @param info The newly discovered information about the gear
+     */
+    void updateDiscoveryInfo(const QBluetoothDeviceInfo& info);
+    /**
+     * The signal strength (in dBm) of the gear when it was last seen during discovery
+     */
+    int signalStrength() const;
+    Q_SIGNAL void signalStrengthChanged();
+    /**
+     * When the gear was last seen during discovery (an invalid date if never)
+     */
+    QDateTime lastSeen() const;
+
     bool supportsOTA();
     void setSupportsOTA(bool supportsOTA);
     Q_SIGNAL void supportsOTAChanged();
@@ -126,7 +158,186 @@ public:
     virtual void connectDevice() = 0;
     virtual void disconnectDevice() = 0;
 
-    QString deviceID() const { return deviceInfo.address().toString(); };
+    /**
+     * A single query sent to the gear as part of the connection handshake
+     */
+    struct HandshakeQuery {
+        QString message; ///< The message to send to the gear
+        bool awaitsReply{true}; ///< Whether the gear is considered ready only once this message has been replied to
+    };
+    /**
+     * Run the handshake with the gear, which should be done once the main
+     * service has been discovered. The queries are sent one at a time: one
+     * which awaits a reply is followed by the next once that reply arrives,
+     * and one which doesn't once it has been written. Once every query which
+     * awaits a reply has been answered (see handshakeReplyReceived), the
+     * commands are reloaded and the gear is considered ready.
+     * If the gear fails to reply in a timely fashion, the query being waited
+     * on is sent once more, and if that also fails, the handshake is
+     * considered completed anyway.
+     * @param queries The queries to send to the gear, in the order they should be sent
+     */
+    void startHandshake(const QList<HandshakeQuery>& queries);
+    /**
+     * Call this when the gear replies to a message sent as part of the handshake
+     * @param message The message which has been replied to
+     */
+    void handshakeReplyReceived(const QString& message);
+    bool isHandshakeComplete() const;
+    /**
+     * Whether the message currently being sent is part of the handshake. Gear
+     * which otherwise refuse to send anything while a firmware update is in
+     * progress should let these through, so they can see the gear come back
+     * after rebooting into the new firmware.
+     */
+    bool isSendingHandshakeQuery() const;
+    Q_SIGNAL void handshakeCompleted();
+    /**
+     * The discovery mode which should be used for the gear's services. Once
+     * we have successfully connected to a gear, we remember the firmware it
+     * was running, and until that changes, we know that the services hold the
+     * characteristics we expect, and skip reading the values of every single
+     * one of them during discovery (we read the ones we need explicitly anyway).
+     * @return The mode to pass to QLowEnergyService::discoverDetails
+     */
+    QLowEnergyService::DiscoveryMode serviceDiscoveryMode() const;
+    /**
+     * Call this if an expected characteristic could not be found on the gear.
+     * This clears the knowledge of the gear's service layout, so the next
+     * discovery will be a full one.
+     * @return True if the layout was previously known, in which case connecting again is worth a try
+     */
+    bool forgetServiceLayout();
+    /**
+     * Connect to the gear again once control returns to the event loop. Use
+     * this after forgetServiceLayout() from inside the handlers of a service's
+     * signals, as connecting tears down the controller and services which are
+     * still busy emitting those signals.
+     */
+    void reconnectWithFullDiscovery();
+
+    /**
+     * The number of milliseconds between the start of the connection attempt and
+     * the completion of the handshake, or -1 if the gear is not ready yet
+     */
+    int timeToReady() const;
+    Q_SIGNAL void timeToReadyChanged();
+
+    /**
+     * The sets of connection parameters we ask the gear to use for the link.
+     * The stack is free to ignore these, but Android maps them to its
+     * connection priority levels, which do make a difference to both
+     * throughput and power use on either end.
+     */
+    enum ConnectionProfile {
+        IdleConnectionProfile, ///< A long connection interval, used once the link has been quiet for a while
+        ActiveConnectionProfile, ///< A short connection interval, used while commands are being sent to the gear
+        TransferConnectionProfile, ///< The shortest possible connection interval, used while uploading firmware
+    };
+    Q_ENUM(ConnectionProfile)
+    ConnectionProfile connectionProfile() const;
+    /**
+     * Request the given connection profile on the current controller. The
+     * active profile is requested automatically when commands are sent, and
+     * the idle profile after a period of no activity, so implementations
+     * should only need to explicitly request the transfer profile.
+     * @param profile The profile to switch to
+     */
+    void setConnectionProfile(ConnectionProfile profile);
+    Q_SIGNAL void connectionProfileChanged();
+    /**
+     * Set the controller which connection profiles should be requested on.
+     * Implementations should call this once their controller has connected.
+     * @param controller The low energy controller used to talk to the gear
+     */
+    void setLowEnergyController(QLowEnergyController* controller);
+
+    /**
+     * The values DeviceModel last handed out for this gear, indexed by role
+     * (counting from DeviceModel::Name). The model owns the contents, and clears
+     * the bit in validRoles for a role whenever the gear notifies of a change to it.
+     */
+    struct ModelSnapshot {
+        quint64 validRoles{0};
+        QVector<QVariant> values;
+    };
+    ModelSnapshot* modelSnapshot() const;
+
+    /**
+     * The policy which decides when to attempt reconnecting to the gear after
+     * the connection has been lost. Implementations should call
+     * ReconnectionPolicy::scheduleAttempt when the connection fails, reset it
+     * once a connection has been successfully established, and attempt a
+     * connection when ReconnectionPolicy::attemptRequested is emitted.
+     */
+    ReconnectionPolicy* reconnectionPolicy() const;
+
+    /**
+     * Implementations should call this immediately before writing a message to
+     * the gear's command characteristic, and messageWriteCompleted once the
+     * stack reports the write as done. The time between the two is used to
+     * estimate how long it takes for a message to reach the gear.
+     * @param message The message about to be written
+     */
+    void messageWriteStarted(const QString& message);
+    /**
+     * Call this when the write started by messageWriteStarted has completed
+     */
+    void messageWriteCompleted();
+    /**
+     * Call this when the gear replies to a PING with a PONG. The round trip
+     * is used as an estimate for the write latency until we have seen some
+     * writes complete.
+     */
+    void pongReceived();
+    /**
+     * A smoothed estimate of the number of milliseconds between us writing a
+     * message and it arriving at the gear, or 0 if we have no measurements yet
+     */
+    int estimatedWriteLatency() const;
+    /**
+     * Implementations should call this whenever a notification arrives from the gear
+     * @param payload The raw value of the notification
+     */
+    void notificationReceived(const QByteArray& payload);
+    /**
+     * Implementations should call this whenever the gear reports that it is
+     * busy, and the message we sent has to be sent again later
+     */
+    void busyRetryScheduled();
+    /**
+     * Timings and counts describing how well the link to the gear is doing
+     */
+    LinkTelemetry* linkTelemetry() const;
+    /**
+     * The most recent traffic between us and the gear
+     */
+    FlightRecorder* flightRecorder() const;
+    /**
+     * The number of milliseconds since we last wrote to or heard from the gear,
+     * or -1 if we have not done either since the connection was established
+     */
+    qint64 msecsSinceLastTraffic() const;
+
+    /**
+     * Send whatever message the gear uses to keep the link alive. This is
+     * called periodically by the HeartbeatScheduler while the gear is
+     * connected, and implementations should skip it if the gear is busy.
+     * The default implementation does nothing.
+     */
+    virtual void sendHeartbeat() {}
+    /**
+     * Whether the heartbeat is also how we find out the gear's battery level,
+     * in which case it is also sent with other traffic going on, but those
+     * extra polls happen less often while the battery level stays the same
+     */
+    virtual bool heartbeatPollsBattery() const { return false; }
+
+    /**
+     * The ID of the device (its bluetooth address in string form), worked out once
+     * on construction, as this gets asked for a lot
+     */
+    const QString& deviceID() const;
 
     virtual void sendMessage(const QString &message) = 0;
 
@@ -16,28 +16,222 @@
  */
 
 #include "GearCommandModel.h"
+#include "CommandTracer.h"
+#include "DeadlineScheduler.h"
+#include "GearBase.h"
 
 #include <QDebug>
-#include <QTimer>
+#include <QElapsedTimer>
+#include <QSet>
+#include <QSettings>
 #include <QRandomGenerator>
 
+#include <algorithm>
+
 class GearCommandModel::Private
 {
 public:
-    Private() {}
+    Private(GearCommandModel* q)
+        : q(q)
+    {}
     ~Private() {}
+    GearCommandModel* q{nullptr};
 
     CommandInfoList commands;
-    QHash<QString,QTimer*> commandDeactivators;
+    QHash<QString, DeadlineScheduler::Handle> commandDeactivators;
+
+    // The row of each command (the first one, if the same command string turns up more than once),
+    // and for each group, how many of its commands are running, and the range of rows its members span
+    struct GroupState {
+        int running{0};
+        int firstRow{-1};
+        int lastRow{-1};
+    };
+    QHash<QString, int> commandRows;
+    QHash<int, GroupState> groups;
+
+    // Call this whenever rows are added or removed
+    void rebuildIndex() {
+        commandRows.clear();
+        groups.clear();
+        for (int row = 0; row < commands.count(); ++row) {
+            const CommandInfo& command = commands.at(row);
+            if (!commandRows.contains(command.command)) {
+                commandRows.insert(command.command, row);
+            }
+            GroupState& group = groups[command.group];
+            if (group.firstRow == -1) {
+                group.firstRow = row;
+            }
+            group.lastRow = row;
+            if (command.isRunning) {
+                ++group.running;
+            }
+        }
+    }
+
+    int rowOf(const CommandInfo& command) const {
+        const int row = commandRows.value(command.command, -1);
+        if (row > -1 && command.equivalent(commands.at(row))) {
+            return row;
+        }
+        // Only if there's more than one command with the same command string
+        for (int other = 0; other < commands.count(); ++other) {
+            if (command.equivalent(commands.at(other))) {
+                return other;
+            }
+        }
+        return -1;
+    }
+
+    // The observed durations are kept per device, firmware version and command. We keep the most recent
+    // few, and schedule by one of the longest of those, as running a little long is harmless, but cutting
+    // a move short (or giving up on it before the gear is done) is not. The very longest is left out once
+    // there are a few to pick from, so a single stalled run doesn't stretch the following ones.
+    static constexpr int maxDurationSamples{9};
+    static constexpr int minDurationSamples{3};
+    bool learnDurations{false};
+    QHash<QString, QElapsedTimer> runStarts;
+    QHash<QString, QVector<int>> durationSamples;
+    QString durationSamplesDevice;
+    QString durationSamplesVersion;
+    // The samples are written out every so often (and when the gear disconnects), rather than every time a command ends
+    static constexpr int saveDurationsDelay{60000};
+    QSet<QString> unsavedDurations;
+    DeadlineScheduler::Handle saveDurationsDeadline{0};
+    // The durations as they were given in the commands files, for when we're not using the learned ones
+    QHash<QString, int> staticDurations;
+
+    GearBase* device() const {
+        return qobject_cast<GearBase*>(q->parent());
+    }
+
+    QString durationSamplesKey(const QString& command) const {
+        return QString::fromUtf8("%1/%2/%3").arg(durationSamplesDevice, durationSamplesVersion, command);
+    }
+
+    void saveDurations() {
+        DeadlineScheduler::instance()->cancel(saveDurationsDeadline);
+        saveDurationsDeadline = 0;
+        if (unsavedDurations.isEmpty()) {
+            return;
+        }
+        QSettings settings;
+        settings.beginGroup("LearnedDurations");
+        for (const QString& command : std::as_const(unsavedDurations)) {
+            QVariantList stored;
+            for (const int sample : durationSamples.value(command)) {
+                stored << sample;
+            }
+            settings.setValue(durationSamplesKey(command), stored);
+        }
+        settings.endGroup();
+        unsavedDurations.clear();
+    }
+
+    // Returns nullptr if we can't tell which firmware the gear is running yet, as the durations are kept per firmware version
+    QVector<int>* samplesFor(const QString& command) {
+        const GearBase* gear = device();
+        if (!gear || gear->version().isEmpty()) {
+            return nullptr;
+        }
+        if (durationSamplesVersion != gear->version() || durationSamplesDevice != gear->deviceID()) {
+            saveDurations();
+            durationSamples.clear();
+            durationSamplesDevice = gear->deviceID();
+            durationSamplesVersion = gear->version();
+        }
+        auto it = durationSamples.find(command);
+        if (it == durationSamples.end()) {
+            QVector<int> samples;
+            QSettings settings;
+            settings.beginGroup("LearnedDurations");
+            const QVariantList stored = settings.value(durationSamplesKey(command)).toList();
+            settings.endGroup();
+            for (const QVariant& sample : stored) {
+                samples << sample.toInt();
+            }
+            it = durationSamples.insert(command, samples);
+        }
+        return &it.value();
+    }
+
+    int learnedDuration(const QString& command) {
+        const QVector<int>* samples = samplesFor(command);
+        if (!samples || samples->count() < minDurationSamples) {
+            return -1;
+        }
+        return estimateDuration(*samples);
+    }
+
+    // The second longest of a full set of samples, and the longest while there are only a few
+    static int estimateDuration(const QVector<int>& samples) {
+        QVector<int> sorted{samples};
+        auto estimate = sorted.end() - 1 - (sorted.count() / 5);
+        std::nth_element(sorted.begin(), estimate, sorted.end());
+        return *estimate;
+    }
+
+    void recordDuration(const QString& command, int duration) {
+        QVector<int>* samples = samplesFor(command);
+        if (!samples) {
+            return;
+        }
+        samples->append(duration);
+        if (samples->count() > maxDurationSamples) {
+            samples->removeFirst();
+        }
+        qCDebug(gearTraffic) << command << "ran for" << duration << "ms, and the estimate from the last" << samples->count() << "runs is" << estimateDuration(*samples);
+        unsavedDurations.insert(command);
+        if (!DeadlineScheduler::instance()->isScheduled(saveDurationsDeadline)) {
+            saveDurationsDeadline = DeadlineScheduler::instance()->schedule(saveDurationsDelay, q, [this](){ saveDurations(); });
+        }
+    }
+
+    // Use the learned duration for the command if we have one and are allowed to, and otherwise the one from the commands file
+    int effectiveDuration(const QString& command) {
+        const int staticDuration = staticDurations.value(command);
+        if (learnDurations) {
+            const int learned = learnedDuration(command);
+            if (learned > 0) {
+                return learned;
+            }
+        }
+        return staticDuration;
+    }
+
+    // Returns true if the duration changed
+    bool applyDuration(int row) {
+        CommandInfo& command = commands[row];
+        const int duration = effectiveDuration(command.command);
+        if (command.duration != duration) {
+            command.duration = duration;
+            return true;
+        }
+        return false;
+    }
 };
 
 GearCommandModel::GearCommandModel(QObject* parent)
     : QAbstractListModel(parent)
-    , d(new Private)
-{}
+    , d(new Private(this))
+{
+    if (GearBase* gear = qobject_cast<GearBase*>(parent)) {
+        connect(gear, &GearBase::isConnectedChanged, this, [this](bool isConnected){
+            if (!isConnected) {
+                d->saveDurations();
+            }
+        });
+    }
+}
 
 GearCommandModel::~GearCommandModel()
 {
+    d->saveDurations();
+    DeadlineScheduler* scheduler = DeadlineScheduler::instance();
+    for (const DeadlineScheduler::Handle handle : std::as_const(d->commandDeactivators)) {
+        scheduler->cancel(handle);
+    }
     delete d;
 }
 
@@ -104,17 +298,42 @@ void GearCommandModel::clear()
 {
     beginResetModel();
     d->commands.clear();
+    d->staticDurations.clear();
+    d->runStarts.clear();
+    d->rebuildIndex();
     endResetModel();
 }
 
 void GearCommandModel::addCommand(const CommandInfo& command)
 {
+    d->staticDurations[command.command] = command.duration;
+    CommandInfo ourCommand{command};
+    ourCommand.duration = d->effectiveDuration(command.command);
     beginInsertRows(QModelIndex(), 0, 0);
-    d->commands.insert(0, command);
-    Q_EMIT commandAdded(command);
+    d->commands.insert(0, ourCommand);
+    d->rebuildIndex();
+    Q_EMIT commandAdded(ourCommand);
     endInsertRows();
 }
 
+void GearCommandModel::setLearnDurations(bool learnDurations)
+{
+    if (d->learnDurations != learnDurations) {
+        d->learnDurations = learnDurations;
+        for (int row = 0; row < d->commands.count(); ++row) {
+            if (d->applyDuration(row)) {
+                const QModelIndex idx = index(row, 0);
+                dataChanged(idx, idx, QVector<int>{GearCommandModel::Duration});
+            }
+        }
+    }
+}
+
+int GearCommandModel::learnedDuration(const QString& command) const
+{
+    return d->learnedDuration(command);
+}
+
 void GearCommandModel::removeCommand(const CommandInfo& command)
 {
     int idx{0};
@@ -130,71 +349,81 @@ void GearCommandModel::removeCommand(const CommandInfo& command)
         beginRemoveRows(QModelIndex(), idx, idx);
         Q_EMIT commandRemoved(command);
         d->commands.removeAt(idx);
+        d->rebuildIndex();
         endRemoveRows();
     }
 }
 
 void GearCommandModel::setRunning(const QString& command, bool isRunning)
 {
-//     qDebug() << "Command changing running state" << command << "being set to" << isRunning;
-    int i = -1;
-    for (CommandInfo& theCommand : d->commands) {
-        ++i;
-//         qDebug() << "Checking" << theCommand->command << "named" << theCommand->name;
-        if(theCommand.command == command) {
-//             qDebug() << "Found matching command!" << i;
-            if(theCommand.isRunning != isRunning) {
-//                 qDebug() << "Changing state";
-                QModelIndex idx = index(i, 0);
-                theCommand.isRunning = isRunning;
-                dataChanged(idx, idx, QVector<int>() << GearCommandModel::IsRunning << GearCommandModel::IsAvailable);
-
-                // ensure isAvailable is correct (check if any are running in our group, and set the availability accordingly)
-                bool hasAnyActive{false};
-                for (const CommandInfo& otherCommand : d->commands) {
-                    if (theCommand.group == otherCommand.group && otherCommand.isRunning) {
-                        hasAnyActive = true;
-                        break;
-                    }
-                }
-                int i2 = -1;
-                for (CommandInfo& otherCommand : d->commands) {
-                    ++i2;
-                    if (otherCommand.group == theCommand.group) {
-                        otherCommand.isAvailable = !hasAnyActive;
-                        QModelIndex idx2 = index(i2, 0);
-                        dataChanged(idx2, idx2, QVector<int>() << GearCommandModel::IsAvailable);
-                    }
+    const int row = d->commandRows.value(command, -1);
+    if (row == -1) {
+        return;
+    }
+    CommandInfo& theCommand = d->commands[row];
+    if(theCommand.isRunning != isRunning) {
+        theCommand.isRunning = isRunning;
+        QVector<int> roles{GearCommandModel::IsRunning};
+        if (isRunning) {
+            d->runStarts[command].start();
+        } else {
+            // If we've not seen the command start (or the watchdog below ended it), there is nothing to learn from
+            const QElapsedTimer runStart = d->runStarts.take(command);
+            if (runStart.isValid()) {
+                d->recordDuration(command, int(runStart.elapsed()));
+                if (d->applyDuration(row)) {
+                    roles << GearCommandModel::Duration;
                 }
             }
+        }
+        CommandTracer* tracer = CommandTracer::instance();
+        if (tracer->isEnabled()) {
+            const GearBase* device = qobject_cast<GearBase*>(parent());
+            const QString deviceID = device ? device->deviceID() : QString{};
             if (isRunning) {
-                // Hackery hacky time - if we end up running for longer than we're supposed to,
-                // assume that we missed something, and set ourselves available again.
-                // Also, we may end up in a situation where we have, in fact, been activated
-                // and deactivated correctly. In that case, let's not deactivate things we need
-                // to keep active. This could be done above, but keeping the code together feels
-                // simpler for future maintenance.
-                QTimer *timer = d->commandDeactivators[theCommand.command];
-                if (!timer) {
-                    timer = new QTimer(this);
-                    d->commandDeactivators[theCommand.command] = timer;
-                    timer->setSingleShot(true);
-                    timer->setInterval(theCommand.duration + theCommand.minimumCooldown);
-                    connect(timer, &QTimer::timeout, this, [this,&theCommand,timer]() {
-                        if (theCommand.isRunning) {
-                            qDebug() << "Automatically deactivating the following command - for some reason we seem to have missed the device ending the command." << theCommand.command;
-                            setRunning(theCommand.command, false);
-                        }
-                        d->commandDeactivators.remove(theCommand.command);
-                        timer->deleteLater();
-                    } );
+                tracer->begin(command, deviceID);
+            } else {
+                tracer->end(command, deviceID);
+            }
+        }
+
+        // Only one command in a group is available while any of them run, so the group's
+        // availability only changes when the first one starts or the last one ends
+        Private::GroupState& group = d->groups[theCommand.group];
+        const bool wasActive = group.running > 0;
+        group.running = qMax(0, group.running + (isRunning ? 1 : -1));
+        const bool hasAnyActive = group.running > 0;
+        if (wasActive != hasAnyActive) {
+            for (int otherRow = group.firstRow; otherRow <= group.lastRow; ++otherRow) {
+                CommandInfo& otherCommand = d->commands[otherRow];
+                if (otherCommand.group == theCommand.group) {
+                    otherCommand.isAvailable = !hasAnyActive;
                 }
-                timer->start();
             }
-            break;
+            roles << GearCommandModel::IsAvailable;
+            dataChanged(index(group.firstRow, 0), index(group.lastRow, 0), roles);
+        } else {
+            const QModelIndex idx = index(row, 0);
+            dataChanged(idx, idx, roles);
         }
     }
-//     qDebug() << "Done changing command running state";
+    if (isRunning) {
+        // Hackery hacky time - if we end up running for longer than we're supposed to,
+        // assume that we missed something, and set ourselves available again.
+        // Also, we may end up in a situation where we have, in fact, been activated
+        // and deactivated correctly. In that case, let's not deactivate things we need
+        // to keep active. This could be done above, but keeping the code together feels
+        // simpler for future maintenance.
+        DeadlineScheduler::instance()->reschedule(d->commandDeactivators[command], theCommand.duration + theCommand.minimumCooldown, this, [this,command]() {
+            d->commandDeactivators.remove(command);
+            const int row = d->commandRows.value(command, -1);
+            if (row > -1 && d->commands.at(row).isRunning) {
+                qDebug() << "Automatically deactivating the following command - for some reason we seem to have missed the device ending the command." << command;
+                d->runStarts.remove(command);
+                setRunning(command, false);
+            }
+        });
+    }
 }
 
 const CommandInfoList& GearCommandModel::allCommands() const
@@ -204,14 +433,8 @@ const CommandInfoList& GearCommandModel::allCommands() const
 
 bool GearCommandModel::isRunning(const CommandInfo& cmd) const
 {
-    bool retVal{false};
-    for (const CommandInfo& ourCmd : d->commands) {
-        if (cmd.equivalent(ourCmd)) {
-            retVal = ourCmd.isRunning;
-            break;
-        }
-    }
-    return retVal;
+    const int row = d->rowOf(cmd);
+    return row > -1 && d->commands.at(row).isRunning;
 }
 
 bool GearCommandModel::isAvailable(const CommandInfo& cmd) const
@@ -221,12 +444,8 @@ bool GearCommandModel::isAvailable(const CommandInfo& cmd) const
     if (cmd.command == tailHomeCommand) {
         retVal = true;
     } else {
-        for (const CommandInfo& ourCmd : d->commands) {
-            if (cmd.equivalent(ourCmd)) {
-                retVal = ourCmd.isAvailable;
-                break;
-            }
-        }
+        const int row = d->rowOf(cmd);
+        retVal = row > -1 && d->commands.at(row).isAvailable;
     }
     return retVal;
 }
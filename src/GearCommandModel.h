@@ -73,8 +73,30 @@ public:
      * @param version The version for the tail we've been connected to
      */
     void autofill(const QString& version);
+    /**
+     * Mark a command as running or not. The time from a command being marked as
+     * running until it is marked as no longer running is recorded, and used to
+     * learn how long the command actually takes on this gear (see setLearnDurations).
+     * @param command The command which started or stopped running
+     * @param isRunning Whether the command is now running
+     */
     void setRunning(const QString& command, bool isRunning);
 
+    /**
+     * Whether to use the durations learned from observing the gear running the
+     * commands in place of the ones from the commands files, once enough runs
+     * have been observed (for the gear's current firmware). The durations are
+     * learned whether or not this is set.
+     * @param learnDurations Whether to use the learned durations
+     */
+    void setLearnDurations(bool learnDurations);
+    /**
+     * The duration to expect for the command, from its most recently observed
+     * durations (the second longest of them, or the longest while there are only
+     * a few), or -1 if it has not been observed running often enough yet
+     */
+    int learnedDuration(const QString& command) const;
+
     /**
      * Get all the commands in this model
      *
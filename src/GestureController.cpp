@@ -22,6 +22,7 @@
 #include "GearBase.h"
 #include "GestureDetectorModel.h"
 #include "GestureSensor.h"
+#include "SensorSampleBus.h"
 #include "WalkingSensorGestureReconizer.h"
 
 // #include <QSensorGestureManager>
@@ -36,9 +37,11 @@ public:
         , connectionManager(nullptr)
     {
         model = new GestureDetectorModel(qq);
+        // All the recognisers share the one bus, so each physical sensor is only opened the once
+        sampleBus = new SensorSampleBus(qq);
 
         QList<GestureSensor*> gestureSensors;
-        gestureSensors << new WalkingSensor(q);
+        gestureSensors << new WalkingSensor(sampleBus, q);
 
         for (GestureSensor *sensor : gestureSensors) {
             QObject::connect(sensor, &GestureSensor::detected, qq, &GestureController::gestureDetected);
@@ -51,6 +54,7 @@ public:
     ~Private() { }
     GestureController* q{nullptr};
     GestureDetectorModel* model{nullptr};
+    SensorSampleBus* sampleBus{nullptr};
     BTConnectionManager* connectionManager{nullptr};
 
     void gestureDetected(const QString& gestureId) {
@@ -62,13 +66,12 @@ public:
             // First get the command from the core model...
             CommandModel * commandModel = qobject_cast<CommandModel *>(connectionManager->commandModel());
             CommandInfo cmd = commandModel->getCommand(gesture->command());
-            for (int i = 0 ; i < deviceModel->count() ; ++i) {
-                GearBase* device = deviceModel->getDeviceById(i);
-                qDebug() << device->deviceID() << "of class type" << device->metaObject()->className() << "is connected?" << device->isConnected() << "is the command available?" << device->commandModel->isAvailable(cmd) << "with the command being" << cmd.command << "and is supposed to be a recipient of this command?" << (gesture->devices().count() == 0 || gesture->devices().contains(device->deviceID()));
-                // Now check if the device is connected, the device model says that command is available,
-                // and that it's supposed to be a recipient
-                if (device->isConnected() && device->commandModel->isAvailable(cmd)
-                    && (gesture->devices().count() == 0 || gesture->devices().contains(device->deviceID()))) {
+            // Only the devices which are supposed to be a recipient
+            const QList<GearBase*> devices = deviceModel->devices(deviceModel->deviceSet(gesture->devices()));
+            for (GearBase* device : devices) {
+                qDebug() << device->deviceID() << "of class type" << device->metaObject()->className() << "is connected?" << device->isConnected() << "is the command available?" << device->commandModel->isAvailable(cmd) << "with the command being" << cmd.command;
+                // Now check if the device is connected, and the device model says that command is available
+                if (device->isConnected() && device->commandModel->isAvailable(cmd)) {
                     device->sendMessage(gesture->command());
                 }
             }
@@ -19,11 +19,11 @@
 #include "GestureController.h"
 #include "GestureSensor.h"
 #include "BTConnectionManager.h"
+#include "DeadlineScheduler.h"
 
 #include <KLocalizedString>
 
 #include <QSettings>
-#include <QTimer>
 
 class GestureDetectorModel::Private {
 public:
@@ -204,7 +204,9 @@ public:
     bool visible{true};
     bool sensorPinned{false};
     bool sensorEnabled{false};
-    QTimer* disabler{nullptr};
+    // One hour of sensing before turning self back off again
+    static constexpr int disableTimeout{60 * 60 * 1000};
+    DeadlineScheduler::Handle disabler{0};
 };
 
 void GestureDetectorModel::setGestureSensorPinned(int index, bool pinned)
@@ -296,15 +298,6 @@ GestureDetails::GestureDetails(QString gestureId, GestureSensor* sensor, Gesture
     d->controller = q;
     d->gestureId = gestureId;
 
-    d->disabler = new QTimer(q);
-    d->disabler->setSingleShot(true);
-    // One hour of sensing before turning self back off again
-    d->disabler->setInterval(60 * 60 * 1000);
-    QObject::connect(d->disabler, &QTimer::timeout, q, [this](){
-        d->controller->model()->setGestureSensorEnabled(this, false);
-        d->controller->connectionManager()->message(i18nc("A message to inform the user a gesture recogniser has been on for too long and has been automatically disabled for the safety and health of their gear", "Disabled %1 detection after one hour. All animatronic gear needs a rest after long periods of use. Read our guide to responsible wagging in Settings for ways to keep your gear healthy.", d->humanName));
-    });
-
     d->humanName = QString::fromUtf8("%1 gesture").arg(gestureId);
     const QString& humanName = sensorNames.value(gestureId);
     if (humanName.isEmpty()) {
@@ -321,6 +314,7 @@ GestureDetails::GestureDetails(QString gestureId, GestureSensor* sensor, Gesture
 }
 
 GestureDetails::~GestureDetails() {
+    DeadlineScheduler::instance()->cancel(d->disabler);
     d->sensor->deleteLater();
 }
 
@@ -411,13 +405,16 @@ bool GestureDetails::visible() const
 void GestureDetails::startDetection()
 {
     d->sensor->startDetection();
-    d->disabler->start();
+    DeadlineScheduler::instance()->reschedule(d->disabler, Private::disableTimeout, d->controller, [this](){
+        d->controller->model()->setGestureSensorEnabled(this, false);
+        d->controller->connectionManager()->message(i18nc("A message to inform the user a gesture recogniser has been on for too long and has been automatically disabled for the safety and health of their gear", "Disabled %1 detection after one hour. All animatronic gear needs a rest after long periods of use. Read our guide to responsible wagging in Settings for ways to keep your gear healthy.", d->humanName));
+    });
 }
 
 void GestureDetails::stopDetection()
 {
     d->sensor->stopDetection();
-    d->disabler->stop();
+    DeadlineScheduler::instance()->cancel(d->disabler);
 }
 
 bool GestureDetails::sensorEnabled() const
@@ -0,0 +1,159 @@
+/*
+ *   Copyright 2026 Dan Leinir Turthra Jensen <admin@leinir.dk>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 3, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Library General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public License
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>
+ */
+
+#include "HeartbeatScheduler.h"
+
+#include "Clock.h"
+#include "DeadlineScheduler.h"
+#include "DeviceModel.h"
+#include "GearBase.h"
+
+#include <QHash>
+
+class HeartbeatScheduler::Private {
+public:
+    Private(HeartbeatScheduler* q)
+        : q(q)
+    {}
+    ~Private() {
+        scheduler->cancel(window);
+    }
+    HeartbeatScheduler* q{nullptr};
+
+    struct GearState {
+        qint64 nextDue{0};
+        // For gear which has to be polled for its battery level, when the next poll is due regardless of other traffic
+        qint64 nextBatteryPoll{0};
+        // How many polls in a row have returned the same battery level
+        int stablePolls{0};
+        int lastBatteryLevel{-1};
+    };
+    QHash<GearBase*, GearState> gear;
+    DeadlineScheduler* scheduler{DeadlineScheduler::instance()};
+    DeadlineScheduler::Handle window{0};
+
+    qint64 elapsed() const {
+        return scheduler->clock()->elapsed();
+    }
+
+    void scheduleWindow() {
+        window = scheduler->schedule(windowInterval, q, [this](){
+            window = 0;
+            wake();
+        });
+    }
+
+    bool isEligible(GearBase* device) const {
+        return device->isConnected() && device->isHandshakeComplete();
+    }
+
+    int interval(const GearState& state) const {
+        return heartbeatInterval * qMin(1 << state.stablePolls, maxBatteryBackoff);
+    }
+
+    void gearBecameReady(GearBase* device) {
+        GearState& state = gear[device];
+        state = GearState{};
+        state.nextDue = elapsed() + heartbeatInterval;
+        state.nextBatteryPoll = state.nextDue;
+        if (!scheduler->isScheduled(window)) {
+            scheduleWindow();
+        }
+    }
+
+    void wake() {
+        const qint64 now = elapsed();
+        // Anything due before the next window would be late if we waited for it, so send it now with the rest
+        const qint64 cutoff = now + windowInterval / 2;
+        bool anyEligible{false};
+        for (auto it = gear.begin(); it != gear.end(); ++it) {
+            GearBase* device = it.key();
+            GearState& state = it.value();
+            if (!isEligible(device)) {
+                continue;
+            }
+            anyEligible = true;
+            if (state.nextDue > cutoff) {
+                continue;
+            }
+            const bool pollsBattery = device->heartbeatPollsBattery();
+            if (!pollsBattery || state.nextBatteryPoll > cutoff) {
+                const qint64 sinceTraffic = device->msecsSinceLastTraffic();
+                if (sinceTraffic > -1 && sinceTraffic < heartbeatInterval) {
+                    // We've heard from the gear recently enough that we know it's there, so try again once that's no longer true
+                    state.nextDue = now - sinceTraffic + heartbeatInterval;
+                    continue;
+                }
+            }
+            if (pollsBattery) {
+                // The keepalive is a battery poll as well, so compare against what the previous poll told us
+                const int batteryLevel = device->batteryLevel();
+                if (batteryLevel == state.lastBatteryLevel) {
+                    state.stablePolls = qMin(state.stablePolls + 1, 8);
+                } else {
+                    state.stablePolls = 0;
+                    state.lastBatteryLevel = batteryLevel;
+                }
+                state.nextBatteryPoll = now + interval(state);
+            }
+            device->sendHeartbeat();
+            state.nextDue = now + heartbeatInterval;
+        }
+        if (anyEligible) {
+            scheduleWindow();
+        }
+    }
+};
+
+HeartbeatScheduler::HeartbeatScheduler(DeviceModel* parent)
+    : QObject(parent)
+    , d(new Private(this))
+{
+    connect(parent, &DeviceModel::deviceAdded, this, [this](GearBase* device){
+        d->gear.insert(device, Private::GearState{});
+        connect(device, &GearBase::handshakeCompleted, this, [this, device](){ d->gearBecameReady(device); });
+    });
+    connect(parent, &DeviceModel::deviceRemoved, this, [this](GearBase* device){
+        device->disconnect(this);
+        d->gear.remove(device);
+    });
+}
+
+HeartbeatScheduler::~HeartbeatScheduler()
+{
+    delete d;
+}
+
+void HeartbeatScheduler::setScheduler(DeadlineScheduler* scheduler)
+{
+    if (!scheduler || scheduler == d->scheduler) {
+        return;
+    }
+    const bool pending = d->scheduler->isScheduled(d->window);
+    d->scheduler->cancel(d->window);
+    d->window = 0;
+    // The new scheduler's clock most likely started somewhere else entirely, so keep everything as far away as it was
+    const qint64 offset = scheduler->clock()->elapsed() - d->elapsed();
+    for (Private::GearState& state : d->gear) {
+        state.nextDue += offset;
+        state.nextBatteryPoll += offset;
+    }
+    d->scheduler = scheduler;
+    if (pending) {
+        d->scheduleWindow();
+    }
+}
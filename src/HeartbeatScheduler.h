@@ -0,0 +1,72 @@
+/*
+ *   Copyright 2026 Dan Leinir Turthra Jensen <admin@leinir.dk>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 3, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Library General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public License
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>
+ */
+
+#ifndef HEARTBEATSCHEDULER_H
+#define HEARTBEATSCHEDULER_H
+
+#include <QObject>
+
+class DeadlineScheduler;
+class DeviceModel;
+class GearBase;
+
+/**
+ * Sends the periodic keepalive (and for some gear, battery poll) messages to
+ * all the connected gear, lined up into shared wake windows, so that with
+ * several pieces of gear connected, the radio wakes up once for all of them,
+ * rather than once for each at their own unrelated times.
+ *
+ * A heartbeat is skipped for gear which has seen traffic recently enough that
+ * we already know the link is alive. Gear which has to be polled for its
+ * battery level is also polled on top of that, though those extra polls slow
+ * down for as long as the level stays the same.
+ *
+ * Gear takes part once it is connected and has completed its handshake, and
+ * the heartbeat itself is sent using GearBase::sendHeartbeat.
+ */
+class HeartbeatScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    explicit HeartbeatScheduler(DeviceModel* parent);
+    ~HeartbeatScheduler() override;
+
+    /**
+     * Set the scheduler used to time the wake windows, and whose clock the
+     * heartbeats are timed by.
+     * @param scheduler The scheduler to use (not taken ownership of)
+     */
+    void setScheduler(DeadlineScheduler* scheduler);
+
+    /**
+     * The number of milliseconds between heartbeats for any one piece of gear
+     */
+    static constexpr int heartbeatInterval{30000};
+    /**
+     * The number of milliseconds between the shared wake windows
+     */
+    static constexpr int windowInterval{10000};
+    /**
+     * The most we will stretch the interval between battery polls, while the battery level stays the same
+     */
+    static constexpr int maxBatteryBackoff{4};
+private:
+    class Private;
+    Private* d;
+};
+
+#endif//HEARTBEATSCHEDULER_H
@@ -21,32 +21,39 @@
 #include "CommandInfo.h"
 #include "BTConnectionManager.h"
 #include "CommandModel.h"
+#include "DeadlineScheduler.h"
 #include "GearBase.h"
 #include "DeviceModel.h"
 
 #include <QRandomGenerator>
-#include <QTimer>
 
 class IdleMode::Private {
 public:
-    Private()
-        : appSettings(nullptr)
+    Private(IdleMode* q)
+        : q(q)
+        , appSettings(nullptr)
         , connectionManager(nullptr)
     {
-        pushTimer.setInterval(0);
-        pushTimer.setSingleShot(true);
-        QObject::connect(&pushTimer, &QTimer::timeout, [this](){ actualPush(); });
     }
-    ~Private() {}
+    ~Private() {
+        scheduler->cancel(pushDeadline);
+    }
+    IdleMode* q{nullptr};
     AppSettings* appSettings{nullptr};
     BTConnectionManager* connectionManager{nullptr};
 
 
     // Now we support multiple tails, we might end up in some odd situation where we get told by multiple tails
     // that we should be doing things. Let's try and avoid that, and postpone this all to the start of the event loop
-    QTimer pushTimer;
+    DeadlineScheduler* scheduler{DeadlineScheduler::instance()};
+    DeadlineScheduler::Handle pushDeadline{0};
     void push() {
-        pushTimer.start();
+        if (!scheduler->isScheduled(pushDeadline)) {
+            pushDeadline = scheduler->schedule(0, q, [this](){
+                pushDeadline = 0;
+                actualPush();
+            });
+        }
     }
     void actualPush() {
         if(connectionManager && connectionManager->isConnected() && appSettings && appSettings->idleMode()) {
@@ -58,20 +65,20 @@ public:
                 if(queue->count() == 0 && appSettings->idleMode() == true && categories.count() > 0) {
                     const CommandInfo& command = commands->getRandomCommand(categories);
                     if(command.isValid()) {
-                        QStringList targetDevices;
+                        DeviceModel::DeviceSet targetDevices{0};
                         DeviceModel * deviceModel = qobject_cast<DeviceModel *>(connectionManager->deviceModel());
                         for (int i = 0 ; i < deviceModel->count() ; ++i) {
                             GearBase* device = deviceModel->getDeviceById(i);
                             // Now check if the device is connected, the device model says that command is available
                             if (device->isConnected() && device->commandModel->isAvailable(command)) {
-                                targetDevices << device->deviceID();
+                                targetDevices |= deviceModel->deviceSet(device);
                             }
                         }
-                        if (targetDevices.length() > 0) {
+                        if (targetDevices != 0) {
                             queue->pushCommand(command.command, targetDevices);
                         }
                     }
-                    queue->pushPause(QRandomGenerator::global()->bounded(appSettings->idleMinPause(), appSettings->idleMaxPause() + 1) * 1000, {});
+                    queue->pushPause(QRandomGenerator::global()->bounded(appSettings->idleMinPause(), appSettings->idleMaxPause() + 1) * 1000, DeviceModel::AllDevices);
                 }
             }
         }
@@ -80,7 +87,7 @@ public:
 
 IdleMode::IdleMode(QObject* parent)
     : QObject(parent)
-    , d(new Private)
+    , d(new Private(this))
 {
 }
 
@@ -126,3 +133,17 @@ void IdleMode::setConnectionManager(BTConnectionManager* connectionManager)
     connect(qobject_cast<QAbstractItemModel*>(d->connectionManager->deviceModel()), &QAbstractItemModel::rowsInserted, this, [this](){ d->push(); });
     connect(qobject_cast<QAbstractItemModel*>(d->connectionManager->deviceModel()), &QAbstractItemModel::rowsRemoved, this, [this](){ d->push(); });
 }
+
+void IdleMode::setScheduler(DeadlineScheduler* scheduler)
+{
+    if (!scheduler || scheduler == d->scheduler) {
+        return;
+    }
+    const bool pending = d->scheduler->isScheduled(d->pushDeadline);
+    d->scheduler->cancel(d->pushDeadline);
+    d->pushDeadline = 0;
+    d->scheduler = scheduler;
+    if (pending) {
+        d->push();
+    }
+}
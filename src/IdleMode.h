@@ -24,6 +24,7 @@
 #include "AppSettings.h"
 
 class BTConnectionManager;
+class DeadlineScheduler;
 
 /**
  * When enabled, Idle Mode will pick a random command from the chosen categories
@@ -41,6 +42,13 @@ public:
 
     void setAppSettings(AppSettings* settings);
     void setConnectionManager(BTConnectionManager* connectionManager);
+    /**
+     * Set the scheduler used to defer picking the next command. The pauses
+     * between commands are timed by the command queue, which should usually
+     * be given the same scheduler.
+     * @param scheduler The scheduler to use (not taken ownership of)
+     */
+    void setScheduler(DeadlineScheduler* scheduler);
 private:
     class Private;
     Private* d;
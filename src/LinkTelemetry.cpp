@@ -0,0 +1,162 @@
+/*
+ *   Copyright 2026 Dan Leinir Turthra Jensen <admin@leinir.dk>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 3, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Library General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public License
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>
+ */
+
+#include "LinkTelemetry.h"
+
+#include <QElapsedTimer>
+#include <QVariantList>
+#include <QVector>
+
+#include <algorithm>
+#include <array>
+
+namespace {
+    // The upper bounds (inclusive, in milliseconds) of the histogram buckets, with a final bucket for anything above the last one
+    constexpr std::array<int, 8> bucketBounds{10, 20, 50, 100, 200, 500, 1000, 2000};
+
+    class RollingHistogram {
+    public:
+        // How many of the most recent samples we keep around
+        static constexpr int windowSize{128};
+
+        void add(int sample) {
+            if (samples.count() < windowSize) {
+                samples.append(sample);
+            } else {
+                samples[next] = sample;
+            }
+            next = (next + 1) % windowSize;
+        }
+
+        QVariantMap toVariantMap() const {
+            QVariantMap result;
+            result[QStringLiteral("count")] = int(samples.count());
+            if (samples.isEmpty()) {
+                return result;
+            }
+            QVector<int> sorted{samples};
+            std::sort(sorted.begin(), sorted.end());
+            const int count = sorted.count();
+            result[QStringLiteral("min")] = sorted.first();
+            result[QStringLiteral("median")] = sorted.at(count / 2);
+            result[QStringLiteral("p95")] = sorted.at(qMin(count - 1, (count * 95) / 100));
+            result[QStringLiteral("max")] = sorted.last();
+            QVariantList buckets;
+            auto it = sorted.cbegin();
+            for (const int bound : bucketBounds) {
+                const auto end = std::upper_bound(it, sorted.cend(), bound);
+                buckets << QVariantMap{{QStringLiteral("upTo"), bound}, {QStringLiteral("count"), int(end - it)}};
+                it = end;
+            }
+            buckets << QVariantMap{{QStringLiteral("upTo"), -1}, {QStringLiteral("count"), int(sorted.cend() - it)}};
+            result[QStringLiteral("buckets")] = buckets;
+            return result;
+        }
+    private:
+        QVector<int> samples;
+        int next{0};
+    };
+}
+
+class LinkTelemetry::Private {
+public:
+    Private() {
+        clock.start();
+    }
+    ~Private() {}
+    RollingHistogram roundTripTime;
+    RollingHistogram writeLatency;
+
+    // The notification rate is worked out from the arrival times of the most recent notifications
+    static constexpr int notificationWindow{10000};
+    static constexpr int maxNotificationTimes{256};
+    QElapsedTimer clock;
+    QVector<qint64> notificationTimes;
+    int nextNotification{0};
+
+    int notifications{0};
+    int busyRetries{0};
+    int reconnects{0};
+
+    double notificationRate() const {
+        const qint64 now = clock.elapsed();
+        int recent{0};
+        qint64 oldest{now};
+        for (const qint64 time : notificationTimes) {
+            if (now - time <= notificationWindow) {
+                ++recent;
+                oldest = qMin(oldest, time);
+            }
+        }
+        // If every notification we remember is recent, the rate is higher than we can see over the whole window
+        const qint64 span = (recent == maxNotificationTimes) ? qMax<qint64>(1, now - oldest) : notificationWindow;
+        return (recent * 1000.0) / span;
+    }
+};
+
+LinkTelemetry::LinkTelemetry()
+    : d(new Private)
+{
+}
+
+LinkTelemetry::~LinkTelemetry()
+{
+    delete d;
+}
+
+void LinkTelemetry::addRoundTripTime(int milliseconds)
+{
+    d->roundTripTime.add(milliseconds);
+}
+
+void LinkTelemetry::addWriteLatency(int milliseconds)
+{
+    d->writeLatency.add(milliseconds);
+}
+
+void LinkTelemetry::addNotification()
+{
+    ++d->notifications;
+    if (d->notificationTimes.count() < Private::maxNotificationTimes) {
+        d->notificationTimes.append(d->clock.elapsed());
+    } else {
+        d->notificationTimes[d->nextNotification] = d->clock.elapsed();
+    }
+    d->nextNotification = (d->nextNotification + 1) % Private::maxNotificationTimes;
+}
+
+void LinkTelemetry::addBusyRetry()
+{
+    ++d->busyRetries;
+}
+
+void LinkTelemetry::addReconnect()
+{
+    ++d->reconnects;
+}
+
+QVariantMap LinkTelemetry::toVariantMap() const
+{
+    return QVariantMap{
+        {QStringLiteral("roundTripTime"), d->roundTripTime.toVariantMap()},
+        {QStringLiteral("writeLatency"), d->writeLatency.toVariantMap()},
+        {QStringLiteral("notificationRate"), d->notificationRate()},
+        {QStringLiteral("notifications"), d->notifications},
+        {QStringLiteral("busyRetries"), d->busyRetries},
+        {QStringLiteral("reconnects"), d->reconnects},
+    };
+}
@@ -0,0 +1,75 @@
+/*
+ *   Copyright 2026 Dan Leinir Turthra Jensen <admin@leinir.dk>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 3, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Library General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public License
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>
+ */
+
+#ifndef LINKTELEMETRY_H
+#define LINKTELEMETRY_H
+
+#include <QVariantMap>
+
+/**
+ * Keeps track of how well the link to a piece of gear is doing, so we can
+ * tell the difference between a sluggish gear and a bad radio environment.
+ *
+ * Timings are kept as rolling histograms over the most recent samples, and
+ * the notification rate is worked out over the last few seconds. Busy retries
+ * and reconnection attempts are counted for the lifetime of the object (which
+ * is the lifetime of the gear object, so across several connections).
+ */
+class LinkTelemetry
+{
+public:
+    LinkTelemetry();
+    ~LinkTelemetry();
+
+    /**
+     * Add the time from a PING being written until its PONG arrived
+     * @param milliseconds The round trip time
+     */
+    void addRoundTripTime(int milliseconds);
+    /**
+     * Add the time from a message being written until the stack reported the write as complete
+     * @param milliseconds The write latency
+     */
+    void addWriteLatency(int milliseconds);
+    /**
+     * Call whenever a notification arrives from the gear
+     */
+    void addNotification();
+    /**
+     * Call whenever the gear tells us it is busy, and we have to try sending again later
+     */
+    void addBusyRetry();
+    /**
+     * Call whenever an attempt to reconnect to the gear is made
+     */
+    void addReconnect();
+
+    /**
+     * A summary of the telemetry, suitable for passing across the replication boundary.
+     * The timings (roundTripTime and writeLatency) are maps containing the sample count,
+     * the minimum, median, 95th percentile and maximum values, and a list of histogram
+     * buckets (maps of upTo, the bucket's inclusive upper bound in milliseconds, or -1
+     * for the last one, and count). The notificationRate is in notifications per second,
+     * and busyRetries, reconnects and notifications are plain counts.
+     */
+    QVariantMap toVariantMap() const;
+private:
+    class Private;
+    Private* d;
+};
+
+#endif//LINKTELEMETRY_H
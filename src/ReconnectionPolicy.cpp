@@ -0,0 +1,120 @@
+/*
+ *   Copyright 2026 Dan Leinir Turthra Jensen <admin@leinir.dk>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 3, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Library General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public License
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>
+ */
+
+#include "ReconnectionPolicy.h"
+
+#include "AppSettings.h"
+#include "DeadlineScheduler.h"
+
+#include <QPointer>
+#include <QRandomGenerator>
+
+class ReconnectionPolicy::Private {
+public:
+    Private() {}
+    ~Private() {}
+    QPointer<AppSettings> appSettings;
+    DeadlineScheduler::Handle attempt{0};
+    int attempts{0};
+
+    // These match the defaults in AppSettings, and are used if we've not been given any settings.
+    // The settings are kept within sensible bounds, so a zero interval can't turn into a busy loop
+    // of reconnection attempts, and the doubling of the delay can't overflow.
+    int baseDelay() const { return qBound(10, appSettings ? appSettings->reconnectBaseDelay() : 250, 60000); }
+    int maxDelay() const { return qBound(baseDelay(), appSettings ? appSettings->reconnectMaxDelay() : 8000, 600000); }
+    int maxAttempts() const { return qBound(0, appSettings ? appSettings->reconnectMaxAttempts() : 10, 1000); }
+    int slowInterval() const { return qBound(5, appSettings ? appSettings->reconnectSlowInterval() : 60, 3600) * 1000; }
+
+    bool isSlowRetry() const { return attempts >= maxAttempts(); }
+
+    int nextDelay() const
+    {
+        if (isSlowRetry()) {
+            // Spread the slow retries by up to ten percent either way
+            const int interval = slowInterval();
+            const int spread = qMax(1, interval / 10);
+            return interval - spread + QRandomGenerator::global()->bounded(2 * spread + 1);
+        }
+        // Double the delay for each attempt, up until the maximum, and then pick somewhere in the upper half of that
+        const int ceiling = int(qMin(qint64(maxDelay()), qint64(baseDelay()) << qMin(attempts, 16)));
+        return (ceiling / 2) + QRandomGenerator::global()->bounded(ceiling - (ceiling / 2) + 1);
+    }
+};
+
+ReconnectionPolicy::ReconnectionPolicy(QObject* parent)
+    : QObject(parent)
+    , d(new Private)
+{
+}
+
+ReconnectionPolicy::~ReconnectionPolicy()
+{
+    DeadlineScheduler::instance()->cancel(d->attempt);
+    delete d;
+}
+
+void ReconnectionPolicy::setAppSettings(AppSettings* settings)
+{
+    d->appSettings = settings;
+}
+
+void ReconnectionPolicy::scheduleAttempt()
+{
+    if (isActive()) {
+        return;
+    }
+    const bool slowRetry = d->isSlowRetry();
+    const int delay = d->nextDelay();
+    d->attempt = DeadlineScheduler::instance()->schedule(delay, this, [this](){
+        d->attempt = 0;
+        ++d->attempts;
+        Q_EMIT attemptRequested();
+    });
+    Q_EMIT attemptScheduled(delay, slowRetry);
+}
+
+void ReconnectionPolicy::reset()
+{
+    DeadlineScheduler::instance()->cancel(d->attempt);
+    d->attempt = 0;
+    d->attempts = 0;
+}
+
+void ReconnectionPolicy::cancel()
+{
+    reset();
+}
+
+bool ReconnectionPolicy::isActive() const
+{
+    return DeadlineScheduler::instance()->isScheduled(d->attempt);
+}
+
+int ReconnectionPolicy::attempts() const
+{
+    return d->attempts;
+}
+
+bool ReconnectionPolicy::isSlowRetry() const
+{
+    return d->isSlowRetry();
+}
+
+int ReconnectionPolicy::maxAttempts() const
+{
+    return d->maxAttempts();
+}
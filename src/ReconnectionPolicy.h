@@ -0,0 +1,97 @@
+/*
+ *   Copyright 2026 Dan Leinir Turthra Jensen <admin@leinir.dk>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 3, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Library General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public License
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>
+ */
+
+#ifndef RECONNECTIONPOLICY_H
+#define RECONNECTIONPOLICY_H
+
+#include <QObject>
+
+class AppSettings;
+
+/**
+ * Decides when to next attempt reconnecting to a piece of gear which has
+ * lost its connection.
+ *
+ * The first attempts are made with an exponentially increasing delay (starting
+ * at AppSettings::reconnectBaseDelay and capped at AppSettings::reconnectMaxDelay),
+ * with a random jitter applied, so that several pieces of gear losing their
+ * connection at the same time do not all hit the radio at once. Once
+ * AppSettings::reconnectMaxAttempts attempts have failed, the policy drops
+ * into a slow retry mode, in which it will keep trying once every
+ * AppSettings::reconnectSlowInterval seconds until either the connection
+ * succeeds, or the policy is cancelled (usually because the user explicitly
+ * disconnected the gear).
+ */
+class ReconnectionPolicy : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ReconnectionPolicy(QObject* parent = nullptr);
+    ~ReconnectionPolicy() override;
+
+    void setAppSettings(AppSettings* settings);
+
+    /**
+     * Schedule the next reconnection attempt. Call this whenever a connection
+     * attempt failed, or an established connection was lost. If an attempt is
+     * already scheduled, this does nothing.
+     */
+    void scheduleAttempt();
+    /**
+     * Call this when a connection has been successfully established, to start
+     * over from the shortest delay the next time the connection is lost.
+     */
+    void reset();
+    /**
+     * Stop any scheduled attempt, and start over from the shortest delay next time.
+     */
+    void cancel();
+
+    /**
+     * Whether there is currently an attempt scheduled
+     */
+    bool isActive() const;
+    /**
+     * How many attempts have been requested since the policy was last reset
+     */
+    int attempts() const;
+    /**
+     * Whether the quick attempts have been exhausted, and the policy is now
+     * only attempting to reconnect at the slow retry interval
+     */
+    bool isSlowRetry() const;
+    /**
+     * The number of quick attempts made before dropping to slow retries
+     */
+    int maxAttempts() const;
+
+    /**
+     * Emitted when a new attempt has been scheduled
+     * @param delay The number of milliseconds until attemptRequested will be emitted
+     * @param slowRetry Whether this attempt is in slow retry mode
+     */
+    Q_SIGNAL void attemptScheduled(int delay, bool slowRetry);
+    /**
+     * Emitted when it is time to attempt a reconnection
+     */
+    Q_SIGNAL void attemptRequested();
+private:
+    class Private;
+    Private* d;
+};
+
+#endif//RECONNECTIONPOLICY_H
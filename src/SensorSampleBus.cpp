@@ -0,0 +1,142 @@
+/*
+ *   Copyright 2026 Dan Leinir Turthra Jensen <admin@leinir.dk>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 3, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Library General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public License
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>
+ */
+
+#include "SensorSampleBus.h"
+
+#include <QAccelerometer>
+#include <QDebug>
+#include <QHash>
+
+#include <array>
+
+class SensorSampleBus::Private {
+public:
+    Private(SensorSampleBus* q)
+        : q(q)
+    {
+        accelerometer.setAccelerationMode(QAccelerometer::Combined);
+    }
+    ~Private() {}
+    SensorSampleBus* q{nullptr};
+
+    // A few seconds worth at the rates we use, so a subscriber which is slow to get round to it doesn't miss anything
+    static constexpr std::size_t accelerometerCapacity{512};
+    QAccelerometer accelerometer;
+    std::array<AccelerometerSample, accelerometerCapacity> accelerometerSamples{};
+    // The number of samples ever written, so the newest is at (accelerometerWritten - 1) % capacity
+    quint64 accelerometerWritten{0};
+
+    struct Subscriber {
+        int dataRate{0};
+        quint64 cursor{0};
+    };
+    QHash<Subscription, Subscriber> accelerometerSubscribers;
+    Subscription nextSubscription{1};
+
+    void updateAccelerometer() {
+        int dataRate{0};
+        for (const Subscriber& subscriber : std::as_const(accelerometerSubscribers)) {
+            dataRate = qMax(dataRate, subscriber.dataRate);
+        }
+        if (dataRate > 0) {
+            if (accelerometer.dataRate() != dataRate) {
+                // A running sensor only picks up a new rate when it is started, so stop it while changing it
+                if (accelerometer.isActive()) {
+                    accelerometer.setActive(false);
+                }
+                accelerometer.setDataRate(dataRate);
+            }
+            if (!accelerometer.isActive()) {
+                accelerometer.setActive(true);
+                accelerometer.setAlwaysOn(true);
+            }
+        } else if (accelerometer.isActive()) {
+            accelerometer.setActive(false);
+            accelerometer.setAlwaysOn(false);
+        }
+    }
+
+    void addAccelerometerReading() {
+        const QAccelerometerReading* reading = accelerometer.reading();
+        if (!reading) {
+            return;
+        }
+        accelerometerSamples[accelerometerWritten % accelerometerCapacity] = AccelerometerSample{
+            reading->timestamp(),
+            static_cast<float>(reading->x()),
+            static_cast<float>(reading->y()),
+            static_cast<float>(reading->z())
+        };
+        ++accelerometerWritten;
+        Q_EMIT q->accelerometerSamplesAvailable();
+    }
+};
+
+SensorSampleBus::SensorSampleBus(QObject* parent)
+    : QObject(parent)
+    , d(new Private(this))
+{
+    connect(&d->accelerometer, &QAccelerometer::readingChanged, this, [this](){ d->addAccelerometerReading(); });
+}
+
+SensorSampleBus::~SensorSampleBus()
+{
+    delete d;
+}
+
+SensorSampleBus::Subscription SensorSampleBus::subscribeAccelerometer(int dataRate)
+{
+    const Subscription subscription = d->nextSubscription++;
+    // Only samples arriving from now on are of interest to a new subscriber
+    d->accelerometerSubscribers.insert(subscription, Private::Subscriber{dataRate, d->accelerometerWritten});
+    d->updateAccelerometer();
+    return subscription;
+}
+
+void SensorSampleBus::unsubscribeAccelerometer(Subscription subscription)
+{
+    if (d->accelerometerSubscribers.remove(subscription) > 0) {
+        d->updateAccelerometer();
+    }
+}
+
+SensorSampleBus::AccelerometerView SensorSampleBus::takeAccelerometerSamples(Subscription subscription)
+{
+    AccelerometerView view;
+    auto it = d->accelerometerSubscribers.find(subscription);
+    if (it == d->accelerometerSubscribers.end()) {
+        return view;
+    }
+    quint64 cursor = it->cursor;
+    const quint64 written = d->accelerometerWritten;
+    if (written - cursor > Private::accelerometerCapacity) {
+        view.dropped = written - cursor - Private::accelerometerCapacity;
+        cursor = written - Private::accelerometerCapacity;
+    }
+    const std::size_t count = written - cursor;
+    if (count > 0) {
+        const std::size_t start = cursor % Private::accelerometerCapacity;
+        view.first = d->accelerometerSamples.data() + start;
+        view.firstCount = qMin(count, Private::accelerometerCapacity - start);
+        if (view.firstCount < count) {
+            view.second = d->accelerometerSamples.data();
+            view.secondCount = count - view.firstCount;
+        }
+    }
+    it->cursor = written;
+    return view;
+}
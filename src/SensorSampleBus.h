@@ -0,0 +1,104 @@
+/*
+ *   Copyright 2026 Dan Leinir Turthra Jensen <admin@leinir.dk>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 3, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Library General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public License
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>
+ */
+
+#ifndef SENSORSAMPLEBUS_H
+#define SENSORSAMPLEBUS_H
+
+#include <QObject>
+
+#include <cstddef>
+
+/**
+ * The one place the gesture recognisers get their sensor readings from.
+ *
+ * Each physical sensor is only opened once, however many recognisers want
+ * its readings, and only while at least one of them does. The readings go
+ * into a single shared ring buffer, and each recogniser has its own cursor
+ * into that buffer, so each one can go through the readings it has not yet
+ * seen without anything being copied for it.
+ *
+ * All of this happens on the thread the bus lives on. Anything a recogniser
+ * wants to do elsewhere, it will have to copy out itself.
+ */
+class SensorSampleBus : public QObject
+{
+    Q_OBJECT
+public:
+    struct AccelerometerSample {
+        quint64 timestamp; // microseconds, as reported by the sensor
+        float x;
+        float y;
+        float z;
+    };
+
+    /**
+     * A view of some samples in the shared buffer. Because the buffer wraps
+     * around, the samples may be in two separate stretches, but indexing into
+     * the view takes care of that. A view is only valid until control returns
+     * to the event loop, as new samples will overwrite the old ones.
+     */
+    struct AccelerometerView {
+        const AccelerometerSample* first{nullptr};
+        std::size_t firstCount{0};
+        const AccelerometerSample* second{nullptr};
+        std::size_t secondCount{0};
+        /// How many samples were overwritten before the subscriber got to them
+        std::size_t dropped{0};
+
+        std::size_t size() const { return firstCount + secondCount; }
+        const AccelerometerSample& operator[](std::size_t index) const {
+            return index < firstCount ? first[index] : second[index - firstCount];
+        }
+    };
+
+    /**
+     * A handle identifying a subscription. 0 is never a valid handle, so it
+     * can be used to mean "not subscribed".
+     */
+    typedef int Subscription;
+
+    explicit SensorSampleBus(QObject* parent = nullptr);
+    ~SensorSampleBus() override;
+
+    /**
+     * Start receiving accelerometer samples. The sensor is run at the highest
+     * rate asked for by any of the subscribers.
+     * @param dataRate The number of samples per second the subscriber would like
+     * @return A handle for the subscription, to pass to the other functions
+     */
+    Subscription subscribeAccelerometer(int dataRate);
+    /**
+     * Stop receiving accelerometer samples. When the last subscriber goes
+     * away, the sensor is switched off.
+     */
+    void unsubscribeAccelerometer(Subscription subscription);
+    /**
+     * Get all the samples which have arrived since the subscriber last asked,
+     * and mark them as seen
+     */
+    AccelerometerView takeAccelerometerSamples(Subscription subscription);
+
+    /**
+     * Emitted whenever new accelerometer samples have been added to the buffer
+     */
+    Q_SIGNAL void accelerometerSamplesAvailable();
+private:
+    class Private;
+    Private* d;
+};
+
+#endif//SENSORSAMPLEBUS_H
@@ -0,0 +1,156 @@
+/*
+ *   Copyright 2026 Dan Leinir Turthra Jensen <admin@leinir.dk>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 3, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Library General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public License
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>
+ */
+
+#include "SignalKernels.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define SIGNALKERNELS_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#define SIGNALKERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+namespace SignalKernels
+{
+
+float mean(const float* data, std::size_t count)
+{
+    if (count == 0) {
+        return 0;
+    }
+    std::size_t i = 0;
+    float sum = 0;
+#if defined(SIGNALKERNELS_SSE2)
+    __m128 sums = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4) {
+        sums = _mm_add_ps(sums, _mm_loadu_ps(data + i));
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, sums);
+    sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(SIGNALKERNELS_NEON)
+    float32x4_t sums = vdupq_n_f32(0);
+    for (; i + 4 <= count; i += 4) {
+        sums = vaddq_f32(sums, vld1q_f32(data + i));
+    }
+    float lanes[4];
+    vst1q_f32(lanes, sums);
+    sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+    for (; i < count; ++i) {
+        sum += data[i];
+    }
+    return sum / static_cast<float>(count);
+}
+
+float removeMean(const float* data, float* output, std::size_t count)
+{
+    const float average = mean(data, count);
+    std::size_t i = 0;
+#if defined(SIGNALKERNELS_SSE2)
+    const __m128 averages = _mm_set1_ps(average);
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(output + i, _mm_sub_ps(_mm_loadu_ps(data + i), averages));
+    }
+#elif defined(SIGNALKERNELS_NEON)
+    const float32x4_t averages = vdupq_n_f32(average);
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(output + i, vsubq_f32(vld1q_f32(data + i), averages));
+    }
+#endif
+    for (; i < count; ++i) {
+        output[i] = data[i] - average;
+    }
+    return average;
+}
+
+std::size_t risingZeroCrossings(const float* data, std::size_t count, std::size_t* crossings)
+{
+    std::size_t found = 0;
+    std::size_t i = 0;
+    // Each step compares four samples with the four samples after them, so stop while there's a full extra one left
+#if defined(SIGNALKERNELS_SSE2)
+    const __m128 zero = _mm_setzero_ps();
+    for (; i + 5 <= count; i += 4) {
+        const __m128 below = _mm_cmplt_ps(_mm_loadu_ps(data + i), zero);
+        const __m128 above = _mm_cmpgt_ps(_mm_loadu_ps(data + i + 1), zero);
+        const int mask = _mm_movemask_ps(_mm_and_ps(below, above));
+        for (int lane = 0; mask && lane < 4; ++lane) {
+            if (mask & (1 << lane)) {
+                crossings[found++] = i + lane;
+            }
+        }
+    }
+#elif defined(SIGNALKERNELS_NEON)
+    const float32x4_t zero = vdupq_n_f32(0);
+    for (; i + 5 <= count; i += 4) {
+        const uint32x4_t below = vcltq_f32(vld1q_f32(data + i), zero);
+        const uint32x4_t above = vcgtq_f32(vld1q_f32(data + i + 1), zero);
+        uint32_t lanes[4];
+        vst1q_u32(lanes, vandq_u32(below, above));
+        for (int lane = 0; lane < 4; ++lane) {
+            if (lanes[lane]) {
+                crossings[found++] = i + lane;
+            }
+        }
+    }
+#endif
+    for (; i + 1 < count; ++i) {
+        if (data[i] < 0 && data[i + 1] > 0) {
+            crossings[found++] = i;
+        }
+    }
+    return found;
+}
+
+std::size_t firstAbove(const float* data, std::size_t count, float threshold)
+{
+    std::size_t i = 0;
+#if defined(SIGNALKERNELS_SSE2)
+    const __m128 thresholds = _mm_set1_ps(threshold);
+    for (; i + 4 <= count; i += 4) {
+        const int mask = _mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(data + i), thresholds));
+        if (mask) {
+            for (int lane = 0; lane < 4; ++lane) {
+                if (mask & (1 << lane)) {
+                    return i + lane;
+                }
+            }
+        }
+    }
+#elif defined(SIGNALKERNELS_NEON)
+    const float32x4_t thresholds = vdupq_n_f32(threshold);
+    for (; i + 4 <= count; i += 4) {
+        uint32_t lanes[4];
+        vst1q_u32(lanes, vcgtq_f32(vld1q_f32(data + i), thresholds));
+        for (int lane = 0; lane < 4; ++lane) {
+            if (lanes[lane]) {
+                return i + lane;
+            }
+        }
+    }
+#endif
+    for (; i < count; ++i) {
+        if (data[i] > threshold) {
+            return i;
+        }
+    }
+    return count;
+}
+
+}
@@ -0,0 +1,61 @@
+/*
+ *   Copyright 2026 Dan Leinir Turthra Jensen <admin@leinir.dk>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 3, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Library General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public License
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>
+ */
+
+#ifndef SIGNALKERNELS_H
+#define SIGNALKERNELS_H
+
+#include <cstddef>
+
+/**
+ * Building blocks for the signal processing done by the gesture recognisers.
+ *
+ * Each of these works on a whole batch of samples in a contiguous buffer of
+ * floats in one go, so they can make use of SSE2 or NEON where available
+ * (and fall back to plain loops elsewhere). None of them allocate, so the
+ * caller is expected to keep its buffers around from one window to the next.
+ */
+namespace SignalKernels
+{
+    /**
+     * The mean of the given samples, or 0 if there are none
+     */
+    float mean(const float* data, std::size_t count);
+    /**
+     * Subtract the mean of the samples from each of them
+     * @param data The samples
+     * @param output Where to write the result (may be the same as data)
+     * @param count How many samples there are
+     * @return The mean which was subtracted
+     */
+    float removeMean(const float* data, float* output, std::size_t count);
+    /**
+     * Find every place the signal crosses zero on its way up, that is every
+     * index for which the sample is below zero and the next one above it.
+     * @param data The samples
+     * @param count How many samples there are
+     * @param crossings Where to write the indices (must have room for count - 1 of them)
+     * @return The number of crossings found
+     */
+    std::size_t risingZeroCrossings(const float* data, std::size_t count, std::size_t* crossings);
+    /**
+     * Find the first sample which is above the given threshold
+     * @return The index of that sample, or count if there was none
+     */
+    std::size_t firstAbove(const float* data, std::size_t count, float threshold);
+}
+
+#endif//SIGNALKERNELS_H
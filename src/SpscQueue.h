@@ -0,0 +1,92 @@
+/*
+ *   Copyright 2026 Dan Leinir Turthra Jensen <admin@leinir.dk>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License as
+ *   published by the Free Software Foundation; either version 3, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Library General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public License
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>
+ */
+
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+/**
+ * A fixed-size queue for handing values from one thread to another without
+ * taking any locks.
+ *
+ * Exactly one thread may push, and exactly one (other) thread may pop. The
+ * pushing thread only ever writes the tail and the popping thread only ever
+ * writes the head, so neither has to wait for the other. When the queue is
+ * full, push() fails rather than blocking, and it is up to the caller to
+ * decide whether to drop the value or try again later.
+ *
+ * @tparam T The type of value in the queue (should be cheap to copy)
+ * @tparam Capacity How many values the queue can hold (must be a power of two)
+ */
+template<typename T, std::size_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity > 1 && (Capacity & (Capacity - 1)) == 0, "The capacity of an SpscQueue must be a power of two");
+public:
+    SpscQueue() = default;
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    /**
+     * Add a value to the end of the queue. Only call this from the producing thread.
+     * @return True if the value was added, or false if the queue was full
+     */
+    bool push(const T& value)
+    {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        m_entries[tail & (Capacity - 1)] = value;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Take the value at the front of the queue. Only call this from the consuming thread.
+     * @return True if a value was taken, or false if the queue was empty
+     */
+    bool pop(T& value)
+    {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = m_entries[head & (Capacity - 1)];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Whether the queue is empty. From any thread other than the consumer, this
+     * is only a hint, as the answer may change at any moment.
+     */
+    bool isEmpty() const
+    {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+private:
+    // Keep the two ends on separate cache lines, so the threads don't keep stealing the line off each other
+    alignas(64) std::atomic<std::size_t> m_head{0};
+    alignas(64) std::atomic<std::size_t> m_tail{0};
+    alignas(64) std::array<T, Capacity> m_entries{};
+};
+
+#endif//SPSCQUEUE_H
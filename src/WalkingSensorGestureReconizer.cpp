@@ -16,23 +16,131 @@
  */
 
 #include "WalkingSensorGestureReconizer.h"
+#include "DeadlineScheduler.h"
+#include "SensorSampleBus.h"
+#include "SignalKernels.h"
+#include "SpscQueue.h"
 
 #include <KLocalizedString>
 
 #include <QCoreApplication>
-#include <QAccelerometer>
+#include <QDebug>
 #include <QElapsedTimer>
-#include <QMutex>
+#include <QPointer>
 #include <QThread>
-#include <QTimer>
 
 #include <algorithm>
-#include <queue>
-#include <vector>
+#include <array>
+#include <atomic>
 
 #define SAMPLE_SIZE (50)
+#define MEDIAN_WINDOW (10)
+// The number of filtered values in each window we look for steps in (the median filter needs a few samples to fill up)
+#define FILTERED_SIZE (SAMPLE_SIZE - MEDIAN_WINDOW - 1)
+// Only the start of each window is searched for zero crossings, to leave room to look ahead for the step itself.
+// This matches the range originally covered by searching overlapping 30 sample stretches, 15 samples apart.
+#define CROSSING_SEARCH_SIZE (((FILTERED_SIZE - 31) / 15) * 15 + 30)
+// How far past a zero crossing to look for the signal rising enough to call it a step, and how far it has to rise
+#define STEP_LOOKAHEAD (20)
+#define STEP_THRESHOLD (0.3f)
 
-using ValueList = std::vector<qreal>;
+/**
+ * The median of the most recent Size values pushed into it, updated one
+ * value at a time. The window is kept both in arrival order (to know which
+ * value drops out next) and in sorted order (to read the median straight
+ * off the middle), so adding a value is a binary search and a short shuffle,
+ * and nothing is ever allocated.
+ */
+template<std::size_t Size>
+class SlidingMedian {
+public:
+    void push(qreal value)
+    {
+        auto sortedEnd = sorted.begin() + count;
+        if (count == Size) {
+            // Take the oldest value out of the sorted window
+            auto oldest = std::lower_bound(sorted.begin(), sortedEnd, arrived[next]);
+            std::move(oldest + 1, sortedEnd, oldest);
+            --sortedEnd;
+        } else {
+            ++count;
+        }
+        auto position = std::upper_bound(sorted.begin(), sortedEnd, value);
+        std::move_backward(position, sortedEnd, sortedEnd + 1);
+        *position = value;
+        arrived[next] = value;
+        next = (next + 1) % Size;
+    }
+    bool isFull() const
+    {
+        return count == Size;
+    }
+    qreal median() const
+    {
+        if (count == 0) {
+            return 0;
+        }
+        const std::size_t index = (count - 1) / 2;
+        if (count % 2) {
+            return sorted[index];
+        }
+        return (sorted[index] + sorted[index + 1]) / static_cast<qreal>(2.0);
+    }
+    void clear()
+    {
+        count = 0;
+        next = 0;
+    }
+private:
+    std::array<qreal, Size> arrived{};
+    std::array<qreal, Size> sorted{};
+    std::size_t count{0};
+    std::size_t next{0};
+};
+
+/**
+ * A fixed number of the most recent samples, oldest first. Once full, each
+ * new sample simply overwrites the oldest one.
+ */
+template<typename T, std::size_t Capacity>
+class SampleRing {
+public:
+    void push(const T& sample)
+    {
+        entries[(first + count) % Capacity] = sample;
+        if (count == Capacity) {
+            first = (first + 1) % Capacity;
+        } else {
+            ++count;
+        }
+    }
+    std::size_t size() const
+    {
+        return count;
+    }
+    bool isEmpty() const
+    {
+        return count == 0;
+    }
+    /// The sample at the given position, counting from the oldest one
+    const T& at(std::size_t index) const
+    {
+        return entries[(first + index) % Capacity];
+    }
+    const T& last() const
+    {
+        return at(count - 1);
+    }
+    void clear()
+    {
+        first = 0;
+        count = 0;
+    }
+private:
+    std::array<T, Capacity> entries{};
+    std::size_t first{0};
+    std::size_t count{0};
+};
 
 WalkingSensorSignaller::WalkingSensorSignaller(WalkingSensor* parent)
     : QObject(parent)
@@ -42,124 +150,103 @@ WalkingSensorSignaller::~WalkingSensorSignaller() = default;
 
 class WalkingSensorPrivate {
 public:
-    WalkingSensorPrivate(WalkingSensor *q)
+    WalkingSensorPrivate(WalkingSensor *q, SensorSampleBus* bus)
         : q(q)
-        , zValue{9.8}
+        , bus(bus)
         , stepCount{0}
     {
-        accelerometer.setDataRate(30);
-        accelerometer.setAccelerationMode(QAccelerometer::Combined);
+        workerThread.setObjectName(QLatin1String{"WalkingSensor"});
+        worker.moveToThread(&workerThread);
     }
-    WalkingSensor* q{nullptr};
-    QTimer timer;
-    QAccelerometer accelerometer;
-    qreal zValue;
-
-    int stepCount;
-    ValueList zVals;
-    QTimer isWalkingTimer;
-
-    void countSteps();
-};
-
-static qreal median(const ValueList& input)
-{
-    auto sorted = input;
-    std::sort(sorted.begin(), sorted.end());
-    auto len = sorted.size();
-    auto index = (len - 1) / 2;
-    if (len % 2) {
-        return sorted[index];
-    } else {
-        return (sorted[index] + sorted[index + 1]) / static_cast<qreal>(2.0);
+    ~WalkingSensorPrivate()
+    {
+        workerThread.quit();
+        workerThread.wait();
     }
-}
-
-static std::vector<int> countZeros(const ValueList& deMeanedArray,
-                            const ValueList& filteredArray)
-{
-    size_t i = 0;
-    std::vector<int> zeroArray;
-    zeroArray.resize(deMeanedArray.size());
-    std::fill(zeroArray.begin(), zeroArray.end(), 0);
+    WalkingSensor* q{nullptr};
+    DeadlineScheduler* scheduler{DeadlineScheduler::instance()};
+    QPointer<SensorSampleBus> bus;
+    SensorSampleBus::Subscription subscription{0};
+    // The rate we ask the accelerometer for, which is what the platform delivers anyway
+    static constexpr int dataRate{30};
+    // The step detection works on windows of a given number of samples, and is tuned for this rate,
+    // so the readings are resampled to it (by interpolating between them) on their way in
+    static constexpr int analysisRate{60};
 
-    while (i < (filteredArray.size() - 30)) {
-        ValueList currentBuffer;
-        std::copy_n(deMeanedArray.begin() + i, std::min(static_cast<std::size_t>(30), deMeanedArray.size() - i),
-                    std::back_inserter(currentBuffer));
-//        qDebug() << i << filteredArray.size() - 30;
-        for (std::size_t bufferIndex = 0;
-             bufferIndex < currentBuffer.size() - 1;
-             ++bufferIndex) {
-            if ((currentBuffer[bufferIndex] < 0) && (currentBuffer[bufferIndex+1] > 0)) {
-                zeroArray[bufferIndex + i] = 1;
-//                qDebug() << "bufferIndex" << bufferIndex
-//                         << currentBuffer[bufferIndex] << currentBuffer[bufferIndex+1];
-            }
-        }
+    // The readings are analysed on their own thread, so a busy main thread (lots of bluetooth or UI traffic)
+    // doesn't make for jittery step detection, and step detection doesn't hold up writing to the gear.
+    // Readings go to the worker, and steps come back, through a queue each way, so neither end waits on the other.
+    QThread workerThread;
+    QObject worker;
+    struct Reading {
+        quint64 timestamp; // microseconds, as reported by the sensor
+        qreal z;
+        // Set when readings were lost before this one, so the filter should start over
+        bool discontinuity;
+    };
+    struct StepEvent {
+        quint64 timestamp;
+    };
+    SpscQueue<Reading, 256> readings;
+    SpscQueue<StepEvent, 64> stepEvents;
+    // Only poke the other thread if it's not already been poked and not yet got round to looking
+    std::atomic<bool> readingsWakeupPending{false};
+    std::atomic<bool> stepsWakeupPending{false};
+    std::atomic<bool> resetRequested{false};
+    // Main thread
+    void queueReading(quint64 timestamp, qreal z, bool discontinuity);
+    bool readingsLost{false};
+    void handleSteps();
+    // Worker thread
+    void handleReadings();
+    void queueStep(quint64 timestamp);
+    std::size_t droppedSteps{0};
 
-        i += 15;
-    }
-    return zeroArray;
-}
+    // Everything from here until countSteps is only touched on the worker thread
+    struct Sample {
+        quint64 timestamp;
+        float filtered;
+    };
+    // If the sensor goes quiet for this long, don't try and find steps across the gap
+    static constexpr quint64 maximumGap{500000};
+    static constexpr quint64 samplePeriod{1000000 / analysisRate};
+    void addReading(quint64 timestamp, qreal z, bool discontinuity);
+    void addSample(quint64 timestamp, qreal z);
+    void reset();
 
-ValueList deMeanValues(const ValueList& filteredArray)
-{
-    ValueList deMeanedArray;
-    deMeanedArray.resize(filteredArray.size());
-    qreal filteredArrayMean = std::accumulate(filteredArray.begin(),
-                                              filteredArray.end(),
-                                              static_cast<qreal>(0))
-            / static_cast<qreal>(filteredArray.size());
-    for (std::size_t i = 0; i < filteredArray.size(); ++i) {
-        deMeanedArray[i] = filteredArray[i] - filteredArrayMean;
-    }
-    return deMeanedArray;
-}
+    // Each reading is passed through the median filter as it arrives, and the filtered values are kept here
+    SlidingMedian<MEDIAN_WINDOW> medianFilter;
+    SampleRing<Sample, 4 * SAMPLE_SIZE> samples;
+    std::size_t sampleCount{0};
+    bool haveReading{false};
+    quint64 lastTimestamp{0};
+    qreal lastZ{0};
+    // When the next resampled value is due
+    quint64 nextSampleTimestamp{0};
+    // The window currently being looked at, kept around so it doesn't get reallocated every time
+    std::array<float, FILTERED_SIZE> window;
+    std::array<std::size_t, FILTERED_SIZE> crossings;
+    void countSteps();
 
-static ValueList medianFiltering(ValueList& zValues)
-{
-    ValueList filteredArray;
-    for (size_t i = 0; i < zValues.size(); ++i) {
-        zValues[i] = zValues[i] - 9.8; // gravity
-        if (i > 10) {
-            ValueList tmpBuff;
-            std::copy_n(zValues.begin() + i - 10, 10,
-                        std::back_inserter(tmpBuff));
-            filteredArray.push_back(median(tmpBuff));
-        }
-    }
-    return filteredArray;
-}
+    int stepCount;
+    // If we've not seen a step for this long, consider the walk over
+    static constexpr int walkingTimeout{4000};
+    DeadlineScheduler::Handle isWalkingDeadline{0};
+    void walkingStopped();
+};
 
-WalkingSensor::WalkingSensor(QObject* parent)
+WalkingSensor::WalkingSensor(SensorSampleBus* bus, QObject* parent)
     : GestureSensor(parent)
-    , d(new WalkingSensorPrivate(this))
+    , d(new WalkingSensorPrivate(this, bus))
 {
-    d->isWalkingTimer.setInterval(4000);
-    QObject::connect(&d->isWalkingTimer, &QTimer::timeout, [this] {
-       Q_EMIT detected(QLatin1String{"walkingStopped"});
-       d->stepCount = 0;
-    });
-    d->isWalkingTimer.setSingleShot(true);
-
-    d->timer.setInterval(16);
-    d->timer.setSingleShot(false);
-    connect(&d->timer, &QTimer::timeout,this, [this](){
-        d->zVals.push_back(d->zValue);
-        if ((d->zVals.size() % SAMPLE_SIZE == 0) && (d->zVals.size() >= SAMPLE_SIZE)) {
-            d->countSteps();
-        }
-        if (d->zVals.size() >= 5000) {
-            ValueList tmp(d->zVals.end() - 1000, d->zVals.end());
-            std::swap(d->zVals, tmp);
+    connect(bus, &SensorSampleBus::accelerometerSamplesAvailable, this, [this](){
+        if (d->subscription) {
+            const SensorSampleBus::AccelerometerView samples = d->bus->takeAccelerometerSamples(d->subscription);
+            for (std::size_t i = 0; i < samples.size(); ++i) {
+                // If the bus had to drop some of our samples, the ones we do get don't follow on from the ones before
+                d->queueReading(samples[i].timestamp, samples[i].z, i == 0 && samples.dropped > 0);
+            }
         }
-        // Q_EMIT zValueTick(d->elapsedTimer.elapsed(), d->zValue - 9.8);
-    });
-
-    QObject::connect(&d->accelerometer, &QAccelerometer::readingChanged, this, [this](){
-        auto value = d->accelerometer.reading();
-        d->zValue = value->z();
     });
 }
 
@@ -187,58 +274,182 @@ QString WalkingSensor::humanName() const
     return humanName;
 }
 
-void WalkingSensor::startDetection()
+void WalkingSensor::setScheduler(DeadlineScheduler* scheduler)
+{
+    if (!scheduler || scheduler == d->scheduler) {
+        return;
+    }
+    const int walkingRemaining = d->scheduler->remainingTime(d->isWalkingDeadline);
+    d->scheduler->cancel(d->isWalkingDeadline);
+    d->isWalkingDeadline = 0;
+    d->scheduler = scheduler;
+    if (walkingRemaining > -1) {
+        d->isWalkingDeadline = d->scheduler->schedule(walkingRemaining, this, [this](){ d->walkingStopped(); });
+    }
+}
+
+WalkingSensor::~WalkingSensor()
 {
-    QMetaObject::invokeMethod(&d->timer, "start", Qt::QueuedConnection);
+    stopDetection();
+    delete d;
+}
 
-    d->accelerometer.setActive(true);
-    d->accelerometer.setAlwaysOn(true);
+void WalkingSensor::startDetection()
+{
+    d->resetRequested = true;
+    if (!d->workerThread.isRunning()) {
+        d->workerThread.start();
+    }
+    if (!d->subscription && d->bus) {
+        d->subscription = d->bus->subscribeAccelerometer(d->dataRate);
+    }
 }
 
 void WalkingSensor::stopDetection()
 {
-    QMetaObject::invokeMethod(&d->timer, "stop", Qt::QueuedConnection);
-    d->accelerometer.setActive(false);
-    d->accelerometer.setAlwaysOn(false);
+    if (d->bus) {
+        d->bus->unsubscribeAccelerometer(d->subscription);
+    }
+    d->subscription = 0;
 }
 /*
 bool WalkingSensorReading::isActive()
 {
-    return d->timer.isActive();
+    return subscription != 0;
 }*/
 
+void WalkingSensorPrivate::queueReading(quint64 timestamp, qreal z, bool discontinuity)
+{
+    if (!readings.push(Reading{timestamp, z, discontinuity || readingsLost})) {
+        // The worker has fallen a long way behind, so there's not a lot of point in adding to its pile
+        readingsLost = true;
+        return;
+    }
+    readingsLost = false;
+    if (!readingsWakeupPending.exchange(true)) {
+        QMetaObject::invokeMethod(&worker, [this](){ handleReadings(); }, Qt::QueuedConnection);
+    }
+}
+
+void WalkingSensorPrivate::handleReadings()
+{
+    // Clear the flag before looking, so anything pushed while we're busy gets us poked again
+    readingsWakeupPending = false;
+    if (resetRequested.exchange(false)) {
+        reset();
+    }
+    Reading reading;
+    while (readings.pop(reading)) {
+        addReading(reading.timestamp, reading.z, reading.discontinuity);
+    }
+}
+
+void WalkingSensorPrivate::queueStep(quint64 timestamp)
+{
+    if (!stepEvents.push(StepEvent{timestamp})) {
+        // The main thread has not got round to the steps for a good long while, so this one is lost
+        ++droppedSteps;
+        qWarning() << "The walking sensor's step queue is full, so a step was dropped," << droppedSteps << "so far";
+    }
+    if (!stepsWakeupPending.exchange(true)) {
+        QMetaObject::invokeMethod(q, [this](){ handleSteps(); }, Qt::QueuedConnection);
+    }
+}
+
+void WalkingSensorPrivate::handleSteps()
+{
+    stepsWakeupPending = false;
+    StepEvent step;
+    while (stepEvents.pop(step)) {
+        stepCount += 1;
+        Q_EMIT q->detected(QLatin1String{"stepDetected"});
+        if (stepCount % 2) {
+            Q_EMIT q->detected(QLatin1String{"oddStepDetected"});
+        } else  {
+            Q_EMIT q->detected(QLatin1String{"evenStepDetected"});
+        }
+        if (!scheduler->isScheduled(isWalkingDeadline)) {
+            Q_EMIT q->detected(QLatin1String{"walkingStarted"});
+        }
+        scheduler->reschedule(isWalkingDeadline, walkingTimeout, q, [this](){ walkingStopped(); });
+    }
+}
+
+void WalkingSensorPrivate::reset()
+{
+    medianFilter.clear();
+    samples.clear();
+    sampleCount = 0;
+    haveReading = false;
+}
+
+void WalkingSensorPrivate::addReading(quint64 timestamp, qreal z, bool discontinuity)
+{
+    if (discontinuity) {
+        reset();
+    }
+    if (haveReading) {
+        if (timestamp == lastTimestamp) {
+            // Some backends report the same reading more than once, and we only want to count it the once
+            return;
+        }
+        if (timestamp < lastTimestamp || timestamp - lastTimestamp > maximumGap) {
+            reset();
+        }
+    }
+    if (!haveReading) {
+        addSample(timestamp, z);
+        nextSampleTimestamp = timestamp + samplePeriod;
+    } else {
+        const qreal span = static_cast<qreal>(timestamp - lastTimestamp);
+        while (nextSampleTimestamp <= timestamp) {
+            const qreal position = static_cast<qreal>(nextSampleTimestamp - lastTimestamp) / span;
+            addSample(nextSampleTimestamp, lastZ + (z - lastZ) * position);
+            nextSampleTimestamp += samplePeriod;
+        }
+    }
+    haveReading = true;
+    lastTimestamp = timestamp;
+    lastZ = z;
+}
+
+void WalkingSensorPrivate::addSample(quint64 timestamp, qreal z)
+{
+    medianFilter.push(z - 9.8); // gravity
+    if (medianFilter.isFull()) {
+        samples.push(Sample{timestamp, static_cast<float>(medianFilter.median())});
+    }
+    ++sampleCount;
+    if (sampleCount % SAMPLE_SIZE == 0) {
+        countSteps();
+    }
+    // Q_EMIT zValueTick(timestamp, z - 9.8);
+}
+
+void WalkingSensorPrivate::walkingStopped()
+{
+    isWalkingDeadline = 0;
+    Q_EMIT q->detected(QLatin1String{"walkingStopped"});
+    stepCount = 0;
+}
+
 void WalkingSensorPrivate::countSteps()
 {
-    if (zVals.size() < SAMPLE_SIZE) {
+    if (samples.size() < FILTERED_SIZE) {
         return;
     }
-    ValueList tmp(zVals.end() - SAMPLE_SIZE, zVals.end());
 //    qDebug() << QDateTime::currentDateTime() << QThread::currentThreadId();
-    auto filteredArray = medianFiltering(tmp);
-    auto deMeanedArray = deMeanValues(filteredArray);
-    auto zeroArray = countZeros(deMeanedArray, filteredArray);
-
-    for (std::size_t i = 0; i < zeroArray.size(); ++i) {
-        auto currentNumber = zeroArray[i];
-
-        if (currentNumber == 1) {
-            for (std::size_t j = i; j < i + 20; ++j) {
-                auto val = deMeanedArray[j];
-                if (val > 0.3) {
-                    stepCount += 1;
-                    Q_EMIT q->detected(QLatin1String{"stepDetected"});
-                    if (stepCount % 2) {
-                        Q_EMIT q->detected(QLatin1String{"oddStepDetected"});
-                    } else  {
-                        Q_EMIT q->detected(QLatin1String{"evenStepDetected"});
-                    }
-                    if (!isWalkingTimer.isActive()) {
-                        Q_EMIT q->detected(QLatin1String{"walkingStarted"});
-                    }
-                    isWalkingTimer.start();
-                    break;
-                }
-            }
+    const std::size_t first = samples.size() - FILTERED_SIZE;
+    for (std::size_t i = 0; i < FILTERED_SIZE; ++i) {
+        window[i] = samples.at(first + i).filtered;
+    }
+    SignalKernels::removeMean(window.data(), window.data(), FILTERED_SIZE);
+    const std::size_t crossingCount = SignalKernels::risingZeroCrossings(window.data(), CROSSING_SEARCH_SIZE, crossings.data());
+    for (std::size_t i = 0; i < crossingCount; ++i) {
+        const std::size_t crossing = crossings[i];
+        const std::size_t lookahead = std::min<std::size_t>(STEP_LOOKAHEAD, FILTERED_SIZE - crossing);
+        if (SignalKernels::firstAbove(window.data() + crossing, lookahead, STEP_THRESHOLD) < lookahead) {
+            queueStep(samples.at(first + crossing).timestamp);
         }
     }
 }
@@ -39,16 +39,29 @@ private:
     Q_DISABLE_COPY(WalkingSensorSignaller)
 };
 
+class DeadlineScheduler;
+class SensorSampleBus;
 class WalkingSensorPrivate;
 class WalkingSensor : public GestureSensor {
     Q_OBJECT
 public:
-    explicit WalkingSensor(QObject *parent);
+    /**
+     * @param bus Where to get the accelerometer readings from
+     */
+    explicit WalkingSensor(SensorSampleBus* bus, QObject *parent);
+    ~WalkingSensor() override;
     QStringList recognizerSignals() const override;
     QString sensorId() const override;
     QString humanName() const override;
     void startDetection() override;
     void stopDetection() override;
+    /**
+     * Set the scheduler used to decide when walking has stopped (the
+     * accelerometer readings themselves arrive as the sensor delivers them).
+     * By default this is DeadlineScheduler::instance().
+     * @param scheduler The scheduler to use (not taken ownership of)
+     */
+    void setScheduler(DeadlineScheduler* scheduler);
 private:
     WalkingSensorPrivate* d{nullptr};
 };
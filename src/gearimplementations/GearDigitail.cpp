@@ -25,6 +25,7 @@
 
 #include "AppSettings.h"
 #include "CommandPersistence.h"
+#include "ReconnectionPolicy.h"
 
 class GearDigitail::Private {
 public:
@@ -44,28 +45,8 @@ public:
     QLowEnergyCharacteristic tailCharacteristic;
     QLowEnergyDescriptor tailDescriptor;
 
-    QTimer batteryTimer;
     QBluetoothUuid tailStateCharacteristicUuid{QLatin1String("{0000ffe1-0000-1000-8000-00805f9b34fb}")};
 
-    int reconnectThrottle{0};
-    void reconnectDevice(QObject* context)
-    {
-        QTimer::singleShot(100, context, [this] {
-            if (btControl) {
-                if (reconnectThrottle > 10) {
-                    q->disconnectDevice();
-                    reconnectThrottle = 0;
-                    q->deviceMessage(q->deviceID(), i18nc("Error message shown when automatic reconnection has been attempted too often", "Attempted to reconnect too many times to %1 (%2). To connect to it, please check that it is on, charged, and near enough.", q->name(), q->deviceID()));
-                    return;
-                }
-                qDebug() << q->name() << q->deviceID() << "Connection lost - attempting to reconnect.";
-                q->deviceMessage(q->deviceID(), i18nc("A status message sent when the connection to a device has been lost, and we are attempting to connect again automatically", "Connection lost to %1, attempting to reconnect...", q->name()));
-                ++reconnectThrottle;
-                btControl->connectToDevice();
-            }
-        });
-    }
-
     void connectToDevice()
     {
         qDebug() << q->name() << q->deviceID() << "Attempting to connect to device";
@@ -87,6 +68,11 @@ public:
             }
             tailCharacteristic = tailService->characteristic(tailStateCharacteristicUuid);
             if (!tailCharacteristic.isValid()) {
+                if (q->forgetServiceLayout()) {
+                    // What we knew about the gear no longer matches what it tells us, so try again with a full discovery
+                    q->reconnectWithFullDiscovery();
+                    break;
+                }
                 qDebug() << q->name() << q->deviceID() << "Tail characteristic not found, this is bad";
                 q->deviceMessage(q->deviceID(), i18nc("A message when sent when attempting to connect to a device which does not have a specific expected feature", "It looks like this device is not a DIGITAiL (could not find the tail characteristic). If you are certain that it definitely is, please report this error to The Tail Company."));
                 q->disconnectDevice();
@@ -99,10 +85,12 @@ public:
             tailDescriptor = tailCharacteristic.descriptor(QBluetoothUuid::DescriptorType::ClientCharacteristicConfiguration);
             tailService->writeDescriptor(tailDescriptor, QByteArray::fromHex("0100"));
 
-            reconnectThrottle = 0;
+            q->reconnectionPolicy()->reset();
             Q_EMIT q->isConnectedChanged(q->isConnected());
             q->setIsConnecting(false);
-            q->sendMessage(QLatin1String{"VER"}); // Ask for the tail version, and then react to the response...
+            // Ask for the tail version, and then react to the response... The DIGITAiL only tells us what a reply is in
+            // response to by way of the current call, so we can't pipeline anything else in here
+            q->startHandshake({GearBase::HandshakeQuery{QLatin1String{"VER"}}});
 
             break;
         }
@@ -115,14 +103,14 @@ public:
     QString previousThing;
     void characteristicChanged(const QLowEnergyCharacteristic &characteristic, const QByteArray &newValue)
     {
-        qDebug() << q->name() << q->deviceID() << "Current call is" << currentCall << "and characteristic" << characteristic.uuid() << "NOTIFIED value change" << newValue;
+        qCDebug(gearTraffic) << q->name() << q->deviceID() << "Current call is" << currentCall << "and characteristic" << characteristic.uuid() << "NOTIFIED value change" << newValue;
+        q->notificationReceived(newValue);
 
         if (tailStateCharacteristicUuid == characteristic.uuid()) {
             if (currentCall == QLatin1String("VER")) {
-                q->reloadCommands();
                 version = QString::fromUtf8(newValue);
                 Q_EMIT q->versionChanged(version);
-                batteryTimer.start();
+                q->handshakeReplyReceived(QLatin1String{"VER"});
                 q->sendMessage(QLatin1String{"BATT"});
             }
             else {
@@ -201,7 +189,8 @@ public:
 
     void characteristicWritten(const QLowEnergyCharacteristic &characteristic, const QByteArray &newValue)
     {
-        qDebug() << q->name() << q->deviceID() << "Characteristic written:" << characteristic.uuid() << newValue;
+        qCDebug(gearTraffic) << q->name() << q->deviceID() << "Characteristic written:" << characteristic.uuid() << newValue;
+        q->messageWriteCompleted();
         currentCall = QString::fromUtf8(newValue);
         Q_EMIT q->currentCallChanged(currentCall);
     }
@@ -212,17 +201,14 @@ GearDigitail::GearDigitail(const QBluetoothDeviceInfo& info, DeviceModel * paren
     , d(new Private(this))
 {
     d->parentModel = parent;
+    connect(reconnectionPolicy(), &ReconnectionPolicy::attemptRequested, this, [this](){
+        if (d->btControl) {
+            d->btControl->connectToDevice();
+        } else {
+            connectDevice();
+        }
+    });
     setHasLights(true);
-
-    // The battery timer also functions as a keepalive call. If it turns
-    // out to be a problem that we pull the battery this often, we can
-    // add a separate ping keepalive functon.
-    connect(&d->batteryTimer, &QTimer::timeout,
-            [this](){ if(d->currentCall.isEmpty()) { sendMessage(QLatin1String{"BATT"}); } });
-
-    d->batteryTimer.setTimerType(Qt::VeryCoarseTimer);
-    d->batteryTimer.setInterval(60000 / 2);
-    d->batteryTimer.setSingleShot(false);
 }
 
 GearDigitail::~GearDigitail()
@@ -266,7 +252,7 @@ void GearDigitail::connectDevice()
                 connect(d->tailService, &QLowEnergyService::stateChanged, this, [this](QLowEnergyService::ServiceState newState){ d->serviceStateChanged(newState); });
                 connect(d->tailService, &QLowEnergyService::characteristicChanged, this, [this](const QLowEnergyCharacteristic& info, const QByteArray& value){ d->characteristicChanged(info, value); });
                 connect(d->tailService, &QLowEnergyService::characteristicWritten, this, [this](const QLowEnergyCharacteristic& info, const QByteArray& value){ d->characteristicWritten(info, value); });
-                d->tailService->discoverDetails();
+                d->tailService->discoverDetails(serviceDiscoveryMode());
             });
 
     connect(d->btControl, &QLowEnergyController::errorOccurred,
@@ -288,7 +274,7 @@ void GearDigitail::connectDevice()
             }
 
             if (d->parentModel->appSettings()->autoReconnect()) {
-                d->reconnectDevice(this);
+                reconnectionPolicy()->scheduleAttempt();
             } else {
                 disconnectDevice();
             }
@@ -296,6 +282,7 @@ void GearDigitail::connectDevice()
 
     connect(d->btControl, &QLowEnergyController::connected, this, [this]() {
         qDebug() << name() << deviceID() << "Controller connected. Search services...";
+        setLowEnergyController(d->btControl);
         d->btControl->discoverServices();
     });
 
@@ -312,7 +299,6 @@ void GearDigitail::connectDevice()
 
 void GearDigitail::disconnectDevice()
 {
-    d->batteryTimer.stop();
     d->btControl->deleteLater();
     d->btControl = nullptr;
     d->tailService->deleteLater();
@@ -348,6 +334,18 @@ QString GearDigitail::currentCall() const
     return d->currentCall;
 }
 
+void GearDigitail::sendHeartbeat()
+{
+    if (d->currentCall.isEmpty()) {
+        sendMessage(QLatin1String{"BATT"});
+    }
+}
+
+bool GearDigitail::heartbeatPollsBattery() const
+{
+    return true;
+}
+
 void GearDigitail::sendMessage(const QString &message)
 {
     // Don't send out another call while we're waiting to hear back... at least for a little bit
@@ -359,6 +357,7 @@ void GearDigitail::sendMessage(const QString &message)
         qApp->processEvents();
     }
     if (d->tailCharacteristic.isValid() && d->tailService) {
+        messageWriteStarted(message);
         d->tailService->writeCharacteristic(d->tailCharacteristic, message.toUtf8());
         d->currentCall = message;
         Q_EMIT currentCallChanged(message);
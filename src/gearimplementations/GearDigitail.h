@@ -36,6 +36,8 @@ public:
     void disconnectDevice() override;
 
     void sendMessage(const QString &message) override;
+    void sendHeartbeat() override;
+    bool heartbeatPollsBattery() const override;
 private:
     class Private;
     Private* d;
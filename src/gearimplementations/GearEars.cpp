@@ -30,9 +30,24 @@
 #include <QTimer>
 
 #include "AppSettings.h"
+#include "DeadlineScheduler.h"
+#include "ReconnectionPolicy.h"
 
 static const QStringList knownARevision{QLatin1String{"VER 1.0.12"}, QLatin1String{"VER 1.0.13"}, QLatin1String{"VER 1.0.14"}};
 static const QStringList knownBRevision{QLatin1String{"VER 1.0.13b"}, QLatin1String{"VER 1.0.14b"}};
+static QString listenModeMessage(GearEars::ListenMode listenMode)
+{
+    switch(listenMode) {
+        case GearEars::ListenModeFull:
+            return QLatin1String{"LISTEN FULL"};
+        case GearEars::ListenModeOn:
+            return QLatin1String{"LISTEN IOS"};
+        case GearEars::ListenModeOff:
+        default:
+            return QLatin1String{"ENDLISTEN"};
+    }
+}
+
 class GearEars::Private {
 public:
     Private(GearEars* qq)
@@ -63,29 +78,9 @@ public:
     QLowEnergyService* batteryService{nullptr};
     QLowEnergyCharacteristic batteryCharacteristic;
 
-    QTimer pingTimer;
     QBluetoothUuid earsCommandWriteCharacteristicUuid{QLatin1String("{05e026d8-b395-4416-9f8a-c00d6c3781b9}")};
     QBluetoothUuid earsCommandReadCharacteristicUuid{QLatin1String("{0b646a19-371e-4327-b169-9632d56c0e84}")};
 
-    int reconnectThrottle{0};
-    void reconnectDevice(QObject* context)
-    {
-        QTimer::singleShot(100, context, [this] {
-            if (btControl) {
-                if (reconnectThrottle > 10) {
-                    q->disconnectDevice();
-                    reconnectThrottle = 0;
-                    q->deviceMessage(q->deviceID(), i18nc("Error message shown when automatic reconnection has been attempted too often", "Attempted to reconnect too many times to %1 (%2). To connect to it, please check that it is on, charged, and near enough.", q->name(), q->deviceID()));
-                    return;
-                }
-                qDebug() << q->name() << q->deviceID() << "Connection lost - attempting to reconnect.";
-                q->deviceMessage(q->deviceID(), i18nc("A status message sent when the connection to a device has been lost, and we are attempting to connect again automatically", "Connection lost to %1, attempting to reconnect...", q->name()));
-                ++reconnectThrottle;
-                btControl->connectToDevice();
-            }
-        });
-    }
-
     void connectToDevice()
     {
         qDebug() << q->name() << q->deviceID() << "Attempting to connect to device";
@@ -108,6 +103,11 @@ public:
 
             earsCommandWriteCharacteristic = earsService->characteristic(earsCommandWriteCharacteristicUuid);
             if (!earsCommandWriteCharacteristic.isValid()) {
+                if (q->forgetServiceLayout()) {
+                    // What we knew about the gear no longer matches what it tells us, so try again with a full discovery
+                    q->reconnectWithFullDiscovery();
+                    break;
+                }
                 qDebug() << q->name() << q->deviceID() << "EarGear command writing characteristic not found, this is bad";
                 q->deviceMessage(q->deviceID(), i18nc("A message when sent when attempting to connect to a device which does not have a specific expected feature", "It looks like this device is not an EarGear controller (could not find the main ears writing characteristic). If you are certain that it definitely is, please report this error to The Tail Company."));
                 q->disconnectDevice();
@@ -125,6 +125,11 @@ public:
 
             earsCommandReadCharacteristic = earsService->characteristic(earsCommandReadCharacteristicUuid);
             if (!earsCommandReadCharacteristic.isValid()) {
+                if (q->forgetServiceLayout()) {
+                    // What we knew about the gear no longer matches what it tells us, so try again with a full discovery
+                    q->reconnectWithFullDiscovery();
+                    break;
+                }
                 qDebug() << q->name() << q->deviceID() << "EarGear command reading characteristic not found, this is bad";
                 q->deviceMessage(q->deviceID(), i18nc("A message when sent when attempting to connect to a device which does not have a specific expected feature", "It looks like this device is not an EarGear controller (could not find the main ears reading characteristic). If you are certain that it definitely is, please report this error to The Tail Company."));
                 q->disconnectDevice();
@@ -142,10 +147,23 @@ public:
                 earsService->writeDescriptor(earsDescriptor, QByteArray::fromHex("0200"));
             }
 
-            reconnectThrottle = 0;
+            q->reconnectionPolicy()->reset();
             Q_EMIT q->isConnectedChanged(q->isConnected());
             q->setIsConnecting(false);
-            q->sendMessage(QLatin1String{"VER"}); // Ask for the version, and then react to the response...
+            // Ask for the version (and then react to the response), and for the hardware revision on EarGear 2, restore the listening
+            // mode, and unless we are reconnecting after a firmware update, also turn off no phone mode, as the user explicitly
+            // picks what to do when disconnecting the app from their gear. The listen mode goes last, as the reply to that can
+            // depend on it being the current call.
+            QList<GearBase::HandshakeQuery> handshake;
+            handshake << GearBase::HandshakeQuery{QLatin1String{"VER"}};
+            if (q->deviceInfo.name() != QLatin1String{"EarGear"}) {
+                handshake << GearBase::HandshakeQuery{QLatin1String{"HWVER"}};
+            }
+            if (firmwareProgress == -1) {
+                handshake << GearBase::HandshakeQuery{QLatin1String{"STOPNPM"}, false};
+            }
+            handshake << GearBase::HandshakeQuery{listenModeMessage(listenMode), false};
+            q->startHandshake(handshake);
 
             break;
         }
@@ -157,7 +175,8 @@ public:
 
     void characteristicChanged(const QLowEnergyCharacteristic &characteristic, const QByteArray &newValue)
     {
-        qDebug() << q->name() << q->deviceID() << "Current call is supposed to be" << currentCall << "and characteristic" << characteristic.uuid() << "NOTIFIED value change" << newValue;
+        qCDebug(gearTraffic) << q->name() << q->deviceID() << "Current call is supposed to be" << currentCall << "and characteristic" << characteristic.uuid() << "NOTIFIED value change" << newValue;
+        q->notificationReceived(newValue);
 
         if (earsCommandReadCharacteristicUuid == characteristic.uuid()) {
             QString theValue = QString::fromUtf8(newValue);
@@ -174,7 +193,8 @@ public:
                 // if (listeningState == ListeningFull || listeningState == ListeningOn) {
                 // }
                 // else {
-                    QTimer::singleShot(1000, q, [this](){ q->sendMessage(currentSubCall); });
+                    q->busyRetryScheduled();
+                    DeadlineScheduler::instance()->schedule(1000, q, [this](){ q->sendMessage(currentSubCall); });
                 //}
             }
             else if (stateResult[0] == QLatin1String{"HWVER"}) {
@@ -193,13 +213,12 @@ public:
                     hardwareRevision = 3;
                     qDebug() << q->name() << q->deviceID() << "Unexpected hardware revision:" << stateResult[1];
                 }
+                q->handshakeReplyReceived(QLatin1String{"HWVER"});
             }
             else if (stateResult[0] == QLatin1String{"VER"}) {
-                q->reloadCommands();
                 version = QString::fromUtf8(newValue);
                 Q_EMIT q->versionChanged(version);
                 Q_EMIT q->supportedTiltEventsChanged();
-                q->setListenMode(listenMode);
                 if (q->deviceInfo.name() == QLatin1String{"EarGear"}) {
                     q->setHasShutdown(false);
                     q->setHasNoPhoneMode(false);
@@ -208,15 +227,17 @@ public:
                     q->setHasShutdown(true);
                     q->setHasNoPhoneMode(true);
                     q->setNoPhoneModeGroups({});
+                    // These firmware versions do not know how to reply to HWVER, so don't wait for them to do so
                     if (knownARevision.contains(version)) {
                         hardwareRevision = 1;
+                        q->handshakeReplyReceived(QLatin1String{"HWVER"});
                     }
                     else if (knownBRevision.contains(version)) {
                         hardwareRevision = 2;
+                        q->handshakeReplyReceived(QLatin1String{"HWVER"});
                     }
-                    q->sendMessage(QLatin1String{"HWVER"});
                 }
-                pingTimer.start();
+                q->handshakeReplyReceived(QLatin1String{"VER"});
                 if (firmwareProgress > -1) {
                     if (otaVersion == q->manuallyLoadedOtaVersion()) {
                         // We have no idea whether the update succeeded, tell the user they need to check themselves
@@ -232,14 +253,13 @@ public:
                     q->setDeviceProgress(-1);
                     firmwareProgress = -1;
                     firmwareChunk.clear();
-                } else {
-                    // Logic here is, the user explicitly picks what to do when disconnecting the app from a tail
-                    q->sendMessage(QLatin1String{"STOPNPM"});
                 }
             }
             else if (stateResult[0] == QLatin1String{"PONG"}) {
                 if (currentCall != QLatin1String{"PING"}) {
                     qWarning() << q->name() << q->deviceID() << "We got an out-of-order response for a ping";
+                } else {
+                    q->pongReceived();
                 }
             }
             else if (theValue == QLatin1String{"EarGear started"}) {
@@ -254,7 +274,7 @@ public:
                 }
             }
             else if (stateResult[0] == QLatin1String("OTA") || firmwareProgress > -1) {
-                qDebug() << q->name() << q->deviceID() << "Firmware update is happening...";
+                qCDebug(gearTraffic) << q->name() << q->deviceID() << "Firmware update is happening...";
             }
             else if (stateResult[0] == QLatin1String{"LISTEN"}) {
                 ListenMode newMode = ListenModeOff;
@@ -331,7 +351,7 @@ public:
                         // Just in case some funny person stuck a pause at the end...
                         if (message.length() > 0) {
                             // Clamp the max single pause duration to 3000 ms (the conceptual human moment)
-                            QTimer::singleShot(qMax(3000, pauseDuration), q, [this, message](){ q->sendMessage(message); });
+                            DeadlineScheduler::instance()->schedule(qMax(3000, pauseDuration), q, [this, message](){ q->sendMessage(message); });
                         }
                     }
                     else {
@@ -386,7 +406,7 @@ public:
                     firmwareProgress += firmwareChunk.size();
                     earsService->writeCharacteristic(earsCommandWriteCharacteristic, firmwareChunk);
                     q->setDeviceProgress(1 + (99 * (firmwareProgress / (double)firmware.size())));
-                    qDebug() << q->name() << q->deviceID() << "Uploading firmware:" << 1 + (99 * (firmwareProgress / (double)firmware.size())) << "%, or" << firmwareProgress << "of" << firmware.size() << "bytes, and the other end says that so far it has received" << receivedBytes;
+                    qCDebug(gearTraffic) << q->name() << q->deviceID() << "Uploading firmware:" << 1 + (99 * (firmwareProgress / (double)firmware.size())) << "%, or" << firmwareProgress << "of" << firmware.size() << "bytes, and the other end says that so far it has received" << receivedBytes;
                 }
                 else {
                     qDebug() << q->name() << q->deviceID() << "The gear says it has have received" << receivedBytes << "out of" << firmware.size() << "which means it should be rebooting momentarily...";
@@ -397,7 +417,8 @@ public:
 
     void characteristicWritten(const QLowEnergyCharacteristic &characteristic, const QByteArray &newValue)
     {
-        qDebug() << q->name() << q->deviceID() << "Characteristic written:" << characteristic.uuid() << newValue;
+        qCDebug(gearTraffic) << q->name() << q->deviceID() << "Characteristic written:" << characteristic.uuid() << newValue;
+        q->messageWriteCompleted();
         currentCall = QString::fromUtf8(newValue);
         Q_EMIT q->currentCallChanged(currentCall);
     }
@@ -489,16 +510,13 @@ GearEars::GearEars(const QBluetoothDeviceInfo& info, DeviceModel * parent)
     , d(new Private(this))
 {
     d->parentModel = parent;
-
-    // The battery timer also functions as a keepalive call. If it turns
-    // out to be a problem that we pull the battery this often, we can
-    // add a separate ping keepalive functon.
-    connect(&d->pingTimer, &QTimer::timeout,
-            [this](){ if(d->currentCall.isEmpty() && d->firmwareProgress == -1) { sendMessage(QLatin1String{"PING"}); } });
-
-    d->pingTimer.setTimerType(Qt::VeryCoarseTimer);
-    d->pingTimer.setInterval(60000 / 2);
-    d->pingTimer.setSingleShot(false);
+    connect(reconnectionPolicy(), &ReconnectionPolicy::attemptRequested, this, [this](){
+        if (d->btControl) {
+            d->btControl->connectToDevice();
+        } else {
+            connectDevice();
+        }
+    });
 
     if (deviceInfo.name() != QLatin1String{"EarGear"}) {
         setSupportsOTA(true);
@@ -550,7 +568,7 @@ void GearEars::connectDevice()
                 connect(d->earsService, &QLowEnergyService::stateChanged, this, [this](QLowEnergyService::ServiceState newState){ d->serviceStateChanged(newState); });
                 connect(d->earsService, &QLowEnergyService::characteristicChanged, this, [this](const QLowEnergyCharacteristic& info, const QByteArray& value){ d->characteristicChanged(info, value); });
                 connect(d->earsService, &QLowEnergyService::characteristicWritten, this, [this](const QLowEnergyCharacteristic& info, const QByteArray& value){ d->characteristicWritten(info, value); });
-                d->earsService->discoverDetails();
+                d->earsService->discoverDetails(serviceDiscoveryMode());
 
                 // Battery service
                 d->batteryService = d->btControl->createServiceObject(QBluetoothUuid::ServiceClassUuid::BatteryService);
@@ -590,6 +608,11 @@ void GearEars::connectDevice()
 
                             d->batteryCharacteristic = d->batteryService->characteristic(QBluetoothUuid::CharacteristicType::BatteryLevel);
                             if (!d->batteryCharacteristic.isValid()) {
+                                if (forgetServiceLayout()) {
+                                    // What we knew about the gear no longer matches what it tells us, so try again with a full discovery
+                                    reconnectWithFullDiscovery();
+                                    break;
+                                }
                                 qDebug() << name() << deviceID() << "EarGear battery level characteristic not found, this is bad";
                                 deviceMessage(deviceID(), i18nc("Warning message when the battery information is unavailable on the device", "It looks like this device is not an EarGear controller (could not find the battery level characteristic). If you are certain that it definitely is, please report this error to The Tail Company."));
                                 disconnectDevice();
@@ -611,7 +634,7 @@ void GearEars::connectDevice()
                             break;
                         }
                     });
-                    d->batteryService->discoverDetails();
+                    d->batteryService->discoverDetails(serviceDiscoveryMode());
                 }
             });
 
@@ -634,7 +657,7 @@ void GearEars::connectDevice()
             }
 
             if (d->parentModel->appSettings()->autoReconnect()) {
-                d->reconnectDevice(this);
+                reconnectionPolicy()->scheduleAttempt();
             } else {
                 disconnectDevice();
             }
@@ -642,6 +665,7 @@ void GearEars::connectDevice()
 
     connect(d->btControl, &QLowEnergyController::connected, this, [this]() {
         qDebug() << name() << deviceID() << "Controller connected. Search services...";
+        setLowEnergyController(d->btControl);
         d->btControl->discoverServices();
     });
 
@@ -665,7 +689,6 @@ void GearEars::connectDevice()
 
 void GearEars::disconnectDevice()
 {
-    d->pingTimer.stop();
     if (d->btControl) {
         d->btControl->deleteLater();
         d->btControl = nullptr;
@@ -716,18 +739,7 @@ GearEars::ListenMode GearEars::listenMode() const
 
 void GearEars::setListenMode(const ListenMode& listenMode)
 {
-    switch(listenMode) {
-        case ListenModeFull:
-            sendMessage(QLatin1String{"LISTEN FULL"});
-            break;
-        case ListenModeOn:
-            sendMessage(QLatin1String{"LISTEN IOS"});
-            break;
-        case ListenModeOff:
-        default:
-            sendMessage(QLatin1String{"ENDLISTEN"});
-            break;
-    }
+    sendMessage(listenModeMessage(listenMode));
 }
 
 bool GearEars::micsSwapped() const
@@ -778,6 +790,13 @@ QVariantList GearEars::supportedSoundEvents()
 }
 
 static const QLatin1Char semicolon{';'};
+void GearEars::sendHeartbeat()
+{
+    if (d->currentCall.isEmpty() && d->firmwareProgress == -1) {
+        sendMessage(QLatin1String{"PING"});
+    }
+}
+
 void GearEars::sendMessage(const QString &message)
 {
     QString actualMessage{message};
@@ -797,6 +816,7 @@ void GearEars::sendMessage(const QString &message)
         }
 
         d->currentSubCall = actualCall;
+        messageWriteStarted(actualCall);
         d->earsService->writeCharacteristic(d->earsCommandWriteCharacteristic, actualCall.toUtf8());
         d->currentCall = message;
         Q_EMIT currentCallChanged(message);
@@ -910,6 +930,7 @@ void GearEars::startOTA()
 {
     setDeviceProgress(0);
     setProgressDescription(i18nc("Message shown during firmware update processes", "Uploading firmware to your gear. Please keep your devices very near each other, and make sure both have plenty of charge (or plug in a charger now). Once completed, your gear will either reboot or turn itself off and disconnect from this device. Once it is started back up again, you will be able to connect to it again."));
+    setConnectionProfile(TransferConnectionProfile);
     // send "OTA (length of firmware in bytes) (md5sum)"
     QString otaInitialiser = QString::fromUtf8("OTA %1 %2").arg(d->firmware.length()).arg(d->firmwareMD5);
     d->earsService->writeCharacteristic(d->earsCommandWriteCharacteristic, otaInitialiser.toUtf8());
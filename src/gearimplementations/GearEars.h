@@ -70,6 +70,7 @@ public:
     QVariantList supportedSoundEvents() override;
 
     void sendMessage(const QString &message) override;
+    void sendHeartbeat() override;
 
     Q_INVOKABLE void checkOTA() override;
     bool hasAvailableOTA() override;
@@ -17,6 +17,7 @@
 
 #include "GearFake.h"
 #include "CommandPersistence.h"
+#include "DeadlineScheduler.h"
 
 #include <KLocalizedString>
 
@@ -94,11 +95,11 @@ QString GearFake::version() const
 void GearFake::connectDevice()
 {
     setIsConnecting(true);
-    QTimer::singleShot(1000, this, [this](){
+    DeadlineScheduler::instance()->schedule(1000, this, [this](){
         d->isConnected = true;
         Q_EMIT isConnectedChanged(isConnected());
         setIsConnecting(false);
-        reloadCommands();
+        startHandshake({});
         setKnownFirmwareMessage(i18nc("An example message to show people what the firmware message will look like for a real device", "This is a message that's supposed to inform people that there is something <b>important</b> going on with their firmware"));
         d->batteryTimer.start();
     });
@@ -131,7 +132,7 @@ void GearFake::sendMessage(const QString& message)
         commandModel->setRunning(message, true);
         d->currentCall = message;
         Q_EMIT currentCallChanged(message);
-        QTimer::singleShot(commandInfo.duration, this, [this, message](){
+        DeadlineScheduler::instance()->schedule(commandInfo.duration, this, [this, message](){
             d->currentCall.clear();
             commandModel->setRunning(message, false);
             Q_EMIT currentCallChanged(currentCall());
@@ -30,6 +30,8 @@
 #include <QTimer>
 
 #include "AppSettings.h"
+#include "DeadlineScheduler.h"
+#include "ReconnectionPolicy.h"
 
 class GearMitailMini::Private {
 public:
@@ -59,31 +61,11 @@ public:
     QLowEnergyCharacteristic batteryCharacteristic;
     QLowEnergyCharacteristic deviceChargingReadCharacteristic;
 
-    QTimer pingTimer;
     QBluetoothUuid deviceServiceUuid{QLatin1String{"3af2108b-d066-42da-a7d4-55648fa0a9b6"}};
     QBluetoothUuid deviceCommandReadCharacteristicUuid{QLatin1String("{c6612b64-0087-4974-939e-68968ef294b0}")};
     QBluetoothUuid deviceCommandWriteCharacteristicUuid{QLatin1String("{5bfd6484-ddee-4723-bfe6-b653372bbfd6}")};
     QBluetoothUuid deviceChargingReadCharacteristicUuid{QLatin1String("{5073792e-4fc0-45a0-b0a5-78b6c1756c91}")};
 
-    int reconnectThrottle{0};
-    void reconnectDevice(QObject* context)
-    {
-        QTimer::singleShot(100, context, [this] {
-            if (btControl) {
-                if (reconnectThrottle > 10) {
-                    q->disconnectDevice();
-                    reconnectThrottle = 0;
-                    q->deviceMessage(q->deviceID(), i18nc("Error message shown when automatic reconnection has been attempted too often", "Attempted to reconnect too many times to %1 (%2). To connect to it, please check that it is on, charged, and near enough.", q->name(), q->deviceID()));
-                    return;
-                }
-                qDebug() << q->name() << q->deviceID() << "Connection lost - attempting to reconnect.";
-                q->deviceMessage(q->deviceID(), i18nc("A status message sent when the connection to a device has been lost, and we are attempting to connect again automatically", "Connection lost to %1, attempting to reconnect...", q->name()));
-                ++reconnectThrottle;
-                btControl->connectToDevice();
-            }
-        });
-    }
-
     void connectToDevice()
     {
         qDebug() << q->name() << q->deviceID() << "Attempting to connect to device";
@@ -106,6 +88,11 @@ public:
 
             deviceCommandWriteCharacteristic = deviceService->characteristic(deviceCommandWriteCharacteristicUuid);
             if (!deviceCommandWriteCharacteristic.isValid()) {
+                if (q->forgetServiceLayout()) {
+                    // What we knew about the gear no longer matches what it tells us, so try again with a full discovery
+                    q->reconnectWithFullDiscovery();
+                    break;
+                }
                 qDebug() << q->name() << q->deviceID() << "MiTail Mini command writing characteristic not found, this is bad";
                 q->deviceMessage(q->deviceID(), i18nc("A message when sent when attempting to connect to a device which does not have a specific expected feature", "It looks like this device is not a MiTail Mini (could not find the main device writing characteristic). If you are certain that it definitely is, please report this error to The Tail Company."));
                 q->disconnectDevice();
@@ -114,6 +101,11 @@ public:
 
             deviceCommandReadCharacteristic = deviceService->characteristic(deviceCommandReadCharacteristicUuid);
             if (!deviceCommandReadCharacteristic.isValid()) {
+                if (q->forgetServiceLayout()) {
+                    // What we knew about the gear no longer matches what it tells us, so try again with a full discovery
+                    q->reconnectWithFullDiscovery();
+                    break;
+                }
                 qDebug() << q->name() << q->deviceID() << "MiTail Mini command reading characteristic not found, this is bad";
                 q->deviceMessage(q->deviceID(), i18nc("A message when sent when attempting to connect to a device which does not have a specific expected feature", "It looks like this device is not a MiTail Mini (could not find the main device reading characteristic). If you are certain that it definitely is, please report this error to The Tail Company."));
                 q->disconnectDevice();
@@ -131,10 +123,17 @@ public:
                 deviceService->writeDescriptor(commandUpdateDescriptor, QByteArray::fromHex("0200"));
             }
 
-            reconnectThrottle = 0;
+            q->reconnectionPolicy()->reset();
             Q_EMIT q->isConnectedChanged(q->isConnected());
             q->setIsConnecting(false);
-            deviceService->writeCharacteristic(deviceCommandWriteCharacteristic, "VER"); // Ask for the version, and then react to the response...
+            // Ask for the version (and then react to the response), and unless we are reconnecting after a firmware update,
+            // also turn off no phone mode, as the user explicitly picks what to do when disconnecting the app from a tail
+            QList<GearBase::HandshakeQuery> handshake;
+            handshake << GearBase::HandshakeQuery{QLatin1String{"VER"}};
+            if (firmwareProgress == -1) {
+                handshake << GearBase::HandshakeQuery{QLatin1String{"STOPNPM"}, false};
+            }
+            q->startHandshake(handshake);
 
             break;
         }
@@ -146,7 +145,8 @@ public:
 
     void characteristicChanged(const QLowEnergyCharacteristic &characteristic, const QByteArray &newValue)
     {
-        qDebug() << q->name() << q->deviceID() << "Current call is supposed to be" << currentCall << "and characteristic" << characteristic.uuid() << "NOTIFIED value change" << newValue;
+        qCDebug(gearTraffic) << q->name() << q->deviceID() << "Current call is supposed to be" << currentCall << "and characteristic" << characteristic.uuid() << "NOTIFIED value change" << newValue;
+        q->notificationReceived(newValue);
 
         if (deviceCommandReadCharacteristicUuid == characteristic.uuid()) {
             QString theValue = QString::fromUtf8(newValue);
@@ -156,14 +156,14 @@ public:
             QStringList stateResult = theValue.split(QLatin1Char{' '});
             if (theValue == QLatin1String{"System is busy now"}) {
                 // Postpone what we attempted to send a few moments before trying again, as the device is currently busy
-                QTimer::singleShot(1000, q, [this](){ q->sendMessage(currentSubCall); });
+                q->busyRetryScheduled();
+                DeadlineScheduler::instance()->schedule(1000, q, [this](){ q->sendMessage(currentSubCall); });
             }
             else if (stateResult[0] == QLatin1String{"VER"}) {
-                q->reloadCommands();
                 version = QString::fromUtf8(newValue);
                 Q_EMIT q->versionChanged(version);
                 q->setKnownFirmwareMessage(knownFirmwareMessages.value(version, QLatin1String{}));
-                pingTimer.start();
+                q->handshakeReplyReceived(QLatin1String{"VER"});
                 if (firmwareProgress > -1) {
                     if (otaVersion == q->manuallyLoadedOtaVersion()) {
                         // We have no idea whether the update succeeded, tell the user they need to check themselves
@@ -179,9 +179,6 @@ public:
                     q->setDeviceProgress(-1);
                     firmwareProgress = -1;
                     firmwareChunk.clear();
-                } else {
-                    // Logic here is, the user explicitly picks what to do when disconnecting the app from a tail
-                    q->sendMessage(QLatin1String{"STOPNPM"});
                 }
             }
             else if (stateResult[0] == QLatin1String{"GLOWTIP"}) {
@@ -190,18 +187,23 @@ public:
                 } else {
                     q->setHasLights(false);
                 }
-                q->reloadCommands();
+                // If this arrives during the handshake, the commands will be loaded once that completes
+                if (q->isHandshakeComplete()) {
+                    q->reloadCommands();
+                }
             }
             else if (stateResult[0] == QLatin1String{"PONG"} || stateResult[0] == QLatin1String{"OK"}) {
                 if (currentCall != QLatin1String{"PING"}) {
                     qWarning() << q->name() << q->deviceID() << "We got an out-of-order response for a ping";
+                } else {
+                    q->pongReceived();
                 }
             }
             else if (theValue.startsWith(QLatin1String{"MiTail Mini started"})) {
                 qDebug() << q->name() << q->deviceID() << "MiTail Mini detected the connection";
             }
             else if (stateResult[0] == QLatin1String("OTA") || firmwareProgress > -1) {
-                qDebug() << "Firmware update is happening...";
+                qCDebug(gearTraffic) << "Firmware update is happening...";
             }
             else if (stateResult.last() == QLatin1String{"BEGIN"}) {
                 q->commandModel->setRunning(currentCall, true);
@@ -226,7 +228,7 @@ public:
                         // Just in case some funny person stuck a pause at the end...
                         if (message.length() > 0) {
                             // Clamp the max single pause duration to 3000 ms (the conceptual human moment)
-                            QTimer::singleShot(qMax(3000, pauseDuration), q, [this, message](){ q->sendMessage(message); });
+                            DeadlineScheduler::instance()->schedule(qMax(3000, pauseDuration), q, [this, message](){ q->sendMessage(message); });
                         }
                     }
                     else {
@@ -258,13 +260,14 @@ public:
                 firmwareProgress += firmwareChunk.size();
                 deviceService->writeCharacteristic(deviceCommandWriteCharacteristic, firmwareChunk);
                 q->setDeviceProgress(1 + (99 * (firmwareProgress / (double)firmware.size())));
-                qDebug() << q->name() << q->deviceID() << "Uploading firmware:" << 1 + (99 * (firmwareProgress / (double)firmware.size())) << "%, or" << firmwareProgress << "of" << firmware.size() << "The newValue value was of length" << newValue.length();
+                qCDebug(gearTraffic) << q->name() << q->deviceID() << "Uploading firmware:" << 1 + (99 * (firmwareProgress / (double)firmware.size())) << "%, or" << firmwareProgress << "of" << firmware.size() << "The newValue value was of length" << newValue.length();
             } else {
                 // we presumably just rebooted...
                 qDebug() << "We presumably just rebooted?";
             }
         } else {
-            qDebug() << q->name() << q->deviceID() << "Characteristic written:" << characteristic.uuid() << newValue;
+            qCDebug(gearTraffic) << q->name() << q->deviceID() << "Characteristic written:" << characteristic.uuid() << newValue;
+            q->messageWriteCompleted();
             currentCall = QString::fromUtf8(newValue);
             Q_EMIT q->currentCallChanged(currentCall);
         }
@@ -357,6 +360,13 @@ GearMitailMini::GearMitailMini(const QBluetoothDeviceInfo& info, DeviceModel * p
     , d(new Private(this))
 {
     d->parentModel = parent;
+    connect(reconnectionPolicy(), &ReconnectionPolicy::attemptRequested, this, [this](){
+        if (d->btControl) {
+            d->btControl->connectToDevice();
+        } else {
+            connectDevice();
+        }
+    });
     setSupportsOTA(true);
     setHasLights(true); // Just in case someone has an old firmware loaded
     setHasShutdown(true);
@@ -366,16 +376,6 @@ GearMitailMini::GearMitailMini(const QBluetoothDeviceInfo& info, DeviceModel * p
         i18nc("Name of the fast and excited group as used for no phone group selection", "Fast and Excited"),
         i18nc("Name of the frustrated and tense group as used for no phone group selection", "Frustrated and Tense"),
     });
-
-    // The battery timer also functions as a keepalive call. If it turns
-    // out to be a problem that we pull the battery this often, we can
-    // add a separate ping keepalive functon.
-    connect(&d->pingTimer, &QTimer::timeout,
-            [this](){ if(d->currentCall.isEmpty() && d->firmwareProgress == -1) { sendMessage(QLatin1String{"PING"}); } });
-
-    d->pingTimer.setTimerType(Qt::VeryCoarseTimer);
-    d->pingTimer.setInterval(60000 / 2);
-    d->pingTimer.setSingleShot(false);
 }
 
 GearMitailMini::~GearMitailMini()
@@ -425,7 +425,7 @@ void GearMitailMini::connectDevice()
                         // This will usually be the android error GATT_INVALID_ATTRIBUTE_LENGTH, which should not usually happen
                         // but as we can't actually read the MTU size out of QLowEnergyCharacteristic until 6.2, we'll just
                         // have to... do a thing and ask people to report back for now.
-                        QTimer::singleShot(10000, this, [this](){
+                        DeadlineScheduler::instance()->schedule(10000, this, [this](){
                             setDeviceProgress(-1);
                             setProgressDescription(QLatin1String{""});
                         });
@@ -435,7 +435,7 @@ void GearMitailMini::connectDevice()
                         d->firmwareChunk.clear();
                     }
                 });
-                d->deviceService->discoverDetails();
+                d->deviceService->discoverDetails(serviceDiscoveryMode());
 
                 // Battery service
                 d->batteryService = d->btControl->createServiceObject(QBluetoothUuid::ServiceClassUuid::BatteryService);
@@ -450,7 +450,7 @@ void GearMitailMini::connectDevice()
                         if (value.length() > 0) {
                             d->batteryLevel = (int)value.at(0) / 20;
                             setBatteryLevelPercent((int)value.at(0));
-                            qDebug() << name() << deviceID() << "Updated battery to" << value;
+                            qCDebug(gearTraffic) << name() << deviceID() << "Updated battery to" << value;
                             Q_EMIT batteryLevelChanged(d->batteryLevel);
                         }
                     });
@@ -494,6 +494,11 @@ void GearMitailMini::connectDevice()
 
                             d->batteryCharacteristic = d->batteryService->characteristic(QBluetoothUuid::CharacteristicType::BatteryLevel);
                             if (!d->batteryCharacteristic.isValid()) {
+                                if (forgetServiceLayout()) {
+                                    // What we knew about the gear no longer matches what it tells us, so try again with a full discovery
+                                    reconnectWithFullDiscovery();
+                                    break;
+                                }
                                 qDebug() << name() << deviceID() << "MiTail Mini battery level characteristic not found, this is bad";
                                 deviceMessage(deviceID(), i18nc("Warning message when the battery information is unavailable on the device", "It looks like this device is not a MiTail Mini (could not find the battery level characteristic). If you are certain that it definitely is, please report this error to The Tail Company."));
                                 disconnectDevice();
@@ -525,7 +530,7 @@ void GearMitailMini::connectDevice()
                             break;
                         }
                     });
-                    d->batteryService->discoverDetails();
+                    d->batteryService->discoverDetails(serviceDiscoveryMode());
                 }
             });
 
@@ -543,8 +548,6 @@ void GearMitailMini::connectDevice()
                 case QLowEnergyController::ConnectionError:
                     if (d->firmwareProgress > -1) {
                         Q_EMIT deviceMessage(deviceID(), i18nc("Warning that some connection failure occurred (usually due to low signal strength)", "Failed to connect to your MiTail Mini. Please try again (perhaps move it closer?)"));
-                    } else {
-                        QTimer::singleShot(2000, this, &GearMitailMini::connectDevice);
                     }
                     break;
                 default:
@@ -552,7 +555,7 @@ void GearMitailMini::connectDevice()
             }
 
             if (d->parentModel->appSettings()->autoReconnect()) {
-                d->reconnectDevice(this);
+                reconnectionPolicy()->scheduleAttempt();
             } else {
                 disconnectDevice();
             }
@@ -560,13 +563,14 @@ void GearMitailMini::connectDevice()
 
     connect(d->btControl, &QLowEnergyController::connected, this, [this]() {
         qDebug() << name() << deviceID() << "Controller connected. Search services...";
+        setLowEnergyController(d->btControl);
         d->btControl->discoverServices();
     });
 
     connect(d->btControl, &QLowEnergyController::disconnected, this, [this]() {
         if (d->firmwareProgress > -1) {
             qDebug() << name() << deviceID() << "Rebooting after firmware installation, say as much and then wait and try a reconnection...";
-            QTimer::singleShot(5000, this, [this](){
+            DeadlineScheduler::instance()->schedule(5000, this, [this](){
                 if (!isConnected()) {
                     setDeviceProgress(0);
                     setProgressDescription(i18nc("Message shown to the user when a firmware upload has completed and the device has rebooted itself", "Attempting to reconnect to your gear..."));
@@ -589,7 +593,6 @@ void GearMitailMini::connectDevice()
 
 void GearMitailMini::disconnectDevice()
 {
-    d->pingTimer.stop();
     if (d->btControl) {
         d->btControl->deleteLater();
         d->btControl = nullptr;
@@ -634,9 +637,16 @@ QString GearMitailMini::currentCall() const
 }
 
 static const QLatin1Char semicolon{';'};
+void GearMitailMini::sendHeartbeat()
+{
+    if (d->currentCall.isEmpty() && d->firmwareProgress == -1) {
+        sendMessage(QLatin1String{"PING"});
+    }
+}
+
 void GearMitailMini::sendMessage(const QString &message)
 {
-    if (d->firmwareProgress == -1) {
+    if (d->firmwareProgress == -1 || isSendingHandshakeQuery()) {
         QString actualMessage{message};
         if (commandShorthands.contains(message)) {
             actualMessage = commandShorthands[message];
@@ -654,6 +664,7 @@ void GearMitailMini::sendMessage(const QString &message)
             }
 
             d->currentSubCall = actualCall;
+            messageWriteStarted(actualCall);
             d->deviceService->writeCharacteristic(d->deviceCommandWriteCharacteristic, actualCall.toUtf8());
             d->currentCall = message;
             Q_EMIT currentCallChanged(message);
@@ -749,6 +760,7 @@ void GearMitailMini::startOTA()
 {
     setDeviceProgress(0);
     setProgressDescription(i18nc("Message shown during firmware update processes", "Uploading firmware to your gear. Please keep your devices very near each other, and make sure both have plenty of charge (or plug in a charger now). Once completed, your gear will restart and disconnect from this device. Once rebooted, you will be able to connect to it again."));
+    setConnectionProfile(TransferConnectionProfile);
     // send "OTA (length of firmware in bytes) (md5sum)"
     QString otaInitialiser = QString::fromUtf8("OTA %1 %2").arg(d->firmware.length()).arg(d->firmwareMD5);
     d->firmwareProgress = 0;
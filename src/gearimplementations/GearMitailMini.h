@@ -38,6 +38,7 @@ public:
     QStringList defaultCommandFiles() const override;
 
     void sendMessage(const QString &message) override;
+    void sendHeartbeat() override;
 
     Q_INVOKABLE void checkOTA() override;
     bool hasAvailableOTA() override;
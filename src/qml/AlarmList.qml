@@ -60,6 +60,8 @@ Kirigami.ScrollablePage {
             id: listItem;
 
             property var dateTime: modelData["time"]
+            // Matches Alarm::Recurrence: none, daily, weekly
+            property int recurrence: modelData["recurrence"] ? modelData["recurrence"] : 0
 
             ColumnLayout {
                 QQC2.Label {
@@ -71,6 +73,13 @@ Kirigami.ScrollablePage {
                           + ", "
                           + (locale.amText ? Qt.formatTime(dateTime, "hh:mm AP") : Qt.formatTime(dateTime, "hh:mm"))
                 }
+
+                QQC2.Label {
+                    visible: listItem.recurrence > 0
+                    text: listItem.recurrence === 1
+                          ? i18nc("Label shown on an alarm which goes off every day", "Repeats every day")
+                          : i18nc("Label shown on an alarm which goes off every week", "Repeats every week")
+                }
             }
 
             onClicked: {
@@ -109,6 +118,21 @@ Kirigami.ScrollablePage {
                     }
                 },
 
+                Kirigami.Action {
+                    text: listItem.recurrence === 0
+                          ? i18nc("Text for an action which makes an alarm which goes off once go off every day instead", "Repeat Every Day")
+                          : listItem.recurrence === 1
+                            ? i18nc("Text for an action which makes an alarm which goes off every day go off every week instead", "Repeat Every Week")
+                            : i18nc("Text for an action which makes a repeating alarm go off only once", "Do Not Repeat");
+                    icon.name: "view-refresh";
+                    displayHint: Kirigami.DisplayHint.KeepVisible;
+                    onTriggered: {
+                        Digitail.AppSettings.setActiveAlarmName(modelData["name"]);
+                        Digitail.AppSettings.setAlarmRecurrence((listItem.recurrence + 1) % 3);
+                        Digitail.AppSettings.setActiveAlarmName("");
+                    }
+                },
+
                 Kirigami.Action {
                     text: i18nc("Text for an action which allows the user to delete an alarm", "Delete this Alarm");
                     icon.name: "list-remove";
@@ -91,6 +91,30 @@ Kirigami.ScrollablePage {
             }
         }
 
+        SettingsCard {
+            headerText: i18nc("Header for the panel for whether or not to synchronise commands sent to several devices, on the settings page", "Move Together");
+            descriptionText: i18nc("Description for the panel for whether or not to synchronise commands sent to several devices, on the settings page", "Some gear takes a little longer than others to receive a command. When sending the same command to more than one piece of gear, the app can hold the command back a tiny bit for the quicker gear, so that everything starts moving at the same time.");
+            footer: QQC2.CheckBox {
+                text: i18nc("Checkbox for the option to synchronise commands sent to several devices, on the panel for synchronised commands in the settings page", "Start Moves Together");
+                checked: Digitail.AppSettings.synchronizedStart;
+                onClicked: {
+                    Digitail.AppSettings.synchronizedStart = !Digitail.AppSettings.synchronizedStart;
+                }
+            }
+        }
+
+        SettingsCard {
+            headerText: i18nc("Header for the panel for whether or not to use learned command durations, on the settings page", "Learn Move Durations");
+            descriptionText: i18nc("Description for the panel for whether or not to use learned command durations, on the settings page", "The app keeps track of how long your gear actually takes to perform each move. Tick this option to use those timings when running a list of moves, rather than the ones listed for the move, which will make the moves follow each other more tightly.");
+            footer: QQC2.CheckBox {
+                text: i18nc("Checkbox for the option to use learned command durations, on the panel for learned command durations in the settings page", "Use Learned Durations");
+                checked: Digitail.AppSettings.learnCommandDurations;
+                onClicked: {
+                    Digitail.AppSettings.learnCommandDurations = !Digitail.AppSettings.learnCommandDurations;
+                }
+            }
+        }
+
         SettingsCard {
             headerText: i18nc("Header for the panel showing known gear, on the settings page", "Known Gear");
             descriptionText: i18nc("Description for the panel showing known gear, on the settings page", "Below is a list of the gear you have previously connected to. You can use this list to perform a number of actions, such as explicitly toggling whether or not to automatically connect to it when it's found, to change its name, and even forgetting it. Forgetting it will disconnect (using the Just Disconnect method) from it, if you are currently connected.");